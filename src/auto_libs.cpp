@@ -0,0 +1,121 @@
+#include "auto_libs.hpp"
+
+#include "lib_catalog.hpp"
+#include "lib_index.hpp"
+#include "mapped_file.hpp"
+#include "object_file.hpp"
+#include "utils.hpp"
+
+#include <functional>
+#include <iostream>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+/// allow looking up a string_view in a set of strings without allocating
+struct StringHash {
+    using is_transparent = void;
+    size_t operator()(string_view str) const { return hash<string_view> {}(str); }
+};
+
+struct SymbolIndex {
+    FileStamp stamp;
+    unordered_set<string, StringHash, equal_to<>> symbols;
+};
+
+/// import library path -> the symbols it defines. Kept for the lifetime of the process (relevant for --server)
+unordered_map<string, SymbolIndex> symbol_indexes;
+
+const SymbolIndex& get_symbol_index(const string& path)
+{
+    FileStamp stamp = get_file_stamp(path);
+    auto iter = symbol_indexes.find(path);
+    if(iter != symbol_indexes.end() && iter->second.stamp == stamp) {
+        return iter->second;
+    }
+
+    SymbolIndex& index = symbol_indexes[path];
+    index.stamp = stamp;
+    index.symbols.clear();
+
+    MappedFile file;
+    if(!file.open(path)) {
+        return index;
+    }
+    // the archive index lists every defined symbol, only read the members when it is missing
+    auto add_symbol = [&index](string_view name) { index.symbols.emplace(name); };
+    if(!scan_archive_index(file.view(), add_symbol)) {
+        scan_object_symbols(file.view(), [&add_symbol](string_view name, bool defined) {
+            if(defined) {
+                add_symbol(name);
+            }
+        });
+    }
+    return index;
+}
+}
+
+void reset_auto_libs_state() { symbol_indexes.clear(); }
+
+string find_import_library(const string& lib_dir, const string& name)
+{
+    return get_lib_index(lib_dir)->find(name, LibPolicy::kPreferImport);
+}
+
+vector<string> resolve_auto_libs(const vector<string>& objects, const vector<string>& requested, const string& lib_dir,
+    const function<string(const string& lib)>& file_name_of)
+{
+    // the index of every installed library file, in link order. Several libraries can share a file: a monolithic
+    // build has a single one for all but gl. A symbol found in a shared file is then credited to the library the
+    // others sharing it depend on (base), which comes last in link order, not to whichever comes first
+    vector<pair<WxLib, const SymbolIndex*>> indexes;
+    unordered_map<string, size_t> index_of_path;
+    for(size_t i = 0; i < kWxLibs.size(); ++i) {
+        string path = find_import_library(lib_dir, file_name_of(string(kWxLibs[i].name)));
+        if(path.empty()) {
+            continue;
+        }
+        auto [iter, inserted] = index_of_path.insert({ path, indexes.size() });
+        if(inserted) {
+            indexes.push_back({ WxLib(i), &get_symbol_index(path) });
+        } else {
+            indexes[iter->second].first = WxLib(i);
+        }
+    }
+
+    LibSet needed = 0;
+    for(const auto& lib : requested) {
+        if(int index = find_wx_lib(lib); index >= 0) {
+            needed |= LibSet(1) << index;
+        }
+    }
+    for(const auto& object : objects) {
+        MappedFile file;
+        if(!file.open(object)) {
+            cerr << "could not open object file: " << object << endl;
+            fatal_exit(1);
+        }
+
+        bool ok = scan_object_symbols(file.view(), [&](string_view name, bool defined) {
+            if(defined) {
+                return;
+            }
+            for(const auto& [lib, index] : indexes) {
+                if(index->symbols.find(name) != index->symbols.end()) {
+                    needed |= lib_bit(lib);
+                    break;
+                }
+            }
+        });
+        if(!ok) {
+            cerr << "unsupported object file format: " << object << endl;
+            fatal_exit(1);
+        }
+    }
+
+    vector<string> libs;
+    for_each_lib(close_lib_set(needed), [&libs](const WxLibInfo& lib) { libs.emplace_back(lib.name); });
+    return libs;
+}
@@ -0,0 +1,33 @@
+#ifndef AUTO_LIBS_HPP
+#define AUTO_LIBS_HPP
+
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief implement `--libs=auto`: pick the wx libraries the target's object files actually use.
+ *
+ * The undefined symbols of `objects` (object files or archives) are looked up in the symbols defined by the wx import
+ * libraries found in `lib_dir`. The libraries defining at least one of them, the libraries in `requested` and all of
+ * their dependencies are returned, in link order (a library comes before the libraries it depends on).
+ *
+ * @param file_name_of map a wx lib name ("core") to the name used on the link line ("wx_mswu_core-3.2"). The import
+ * library is searched as `lib<name>.dll.a`, `lib<name>.a` and `<name>.lib`. Libraries that are not installed are
+ * ignored
+ */
+vector<string> resolve_auto_libs(const vector<string>& objects, const vector<string>& requested, const string& lib_dir,
+    const function<string(const string& lib)>& file_name_of);
+
+/**
+ * @brief the path of the import (or static) library `name` in `lib_dir`: `lib<name>.dll.a`, `lib<name>.a` or
+ * `<name>.lib`. Empty if none exists
+ */
+string find_import_library(const string& lib_dir, const string& name);
+
+/// forget the symbol indexes read so far (they are otherwise kept, keyed on the file's mtime and size)
+void reset_auto_libs_state();
+
+#endif // AUTO_LIBS_HPP
@@ -0,0 +1,436 @@
+#include "bake.hpp"
+
+#include "lib_catalog.hpp"
+#include "pch.hpp"
+
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+/// the options that change the output: a baked program accepts the ones it was baked with and nothing else
+constexpr const char* kBakedOptions[] = { "--canonical", "--absolute", "--remap-prefix", "--profile" };
+
+/// the --libs lists a baked program accepts on a single command line
+constexpr size_t kMaxLists = 16;
+
+/// the part of the baked program that does not depend on the install: command line parsing and output
+constexpr const char* kRuntime = R"(
+/// `arg` is exactly `str`
+bool equals(const char* arg, string_view str)
+{
+    return strlen(arg) == str.length() && memcmp(arg, str.data(), str.length()) == 0;
+}
+
+bool has_prefix(const char* arg, string_view prefix) { return strncmp(arg, prefix.data(), prefix.length()) == 0; }
+
+const char* after_equal(const char* arg)
+{
+    const char* eq = strchr(arg, '=');
+    return eq ? eq + 1 : "";
+}
+
+/// \ -> / and, for the prefix, without the trailing separators and blanks, as the full tools do
+bool same_path(const char* arg, string_view baked, bool is_prefix)
+{
+    static char buffer[4096];
+    size_t length = strlen(arg);
+    if(length >= sizeof(buffer)) {
+        return false;
+    }
+    for(size_t i = 0; i < length; ++i) {
+        buffer[i] = arg[i] == '\\' ? '/' : arg[i];
+    }
+    while(is_prefix && length > 0 && strchr(" \t/", buffer[length - 1])) {
+        --length;
+    }
+    return string_view(buffer, length) == baked;
+}
+
+/// same as CommandLineParser::parse_libs() + expand_libs(). False for --libs auto
+bool parse_libs(const char* list, unsigned& libs)
+{
+    bool empty = true;
+    libs = kLibs[kBase].deps;
+    while(true) {
+        const char* comma = strchr(list, ',');
+        size_t length = comma ? size_t(comma - list) : strlen(list);
+        // split_by_comma() only trims from the right
+        while(length > 0 && strchr(" \n\r\t", list[length - 1])) {
+            --length;
+        }
+        string_view name(list, length);
+        if(name == "auto") {
+            return false;
+        }
+        if(!name.empty()) {
+            empty = false;
+            if(name == "std") {
+                libs |= kStd;
+            } else if(name == "all") {
+                libs |= kAll;
+            } else {
+                for(const auto& lib : kLibs) {
+                    if(lib.name == name) {
+                        libs |= lib.deps;
+                    }
+                }
+            }
+        }
+        if(!comma) {
+            break;
+        }
+        list = comma + 1;
+    }
+    if(empty) {
+        libs = kStd;
+    }
+    return true;
+}
+
+char output[kMaxOutput];
+size_t output_length = 0;
+
+void append(string_view str)
+{
+    memcpy(output + output_length, str.data(), str.length());
+    output_length += str.length();
+}
+
+bool write_all(const char* data, size_t length)
+{
+    while(length > 0) {
+#ifdef _WIN32
+        int written = _write(1, data, static_cast<unsigned>(length));
+#else
+        ssize_t written = ::write(1, data, length);
+#endif
+        if(written <= 0) {
+            return false;
+        }
+        data += written;
+        length -= size_t(written);
+    }
+    return true;
+}
+
+int reject(const char* arg)
+{
+    fprintf(stderr, "%.*s: baked for %.*s%s%.*s, can not answer: %s\n", int(kTool.length()), kTool.data(),
+        int(kPrefix.length()), kPrefix.data(), kConfig.empty() ? "" : " ", int(kConfig.length()), kConfig.data(), arg);
+    return 1;
+}
+
+/// same as write_generated_file(): leave the file alone when it is up to date, print its full path
+int write_cmake_file()
+{
+    const char* filename = "wxWidgets.cmake";
+    bool up_to_date = false;
+    if(FILE* fp = fopen(filename, "rb")) {
+        static char current[kCMake.length() + 1];
+        up_to_date = fread(current, 1, sizeof(current), fp) == kCMake.length()
+                     && string_view(current, kCMake.length()) == kCMake;
+        fclose(fp);
+    }
+    if(!up_to_date) {
+        char tmp_name[64];
+        snprintf(tmp_name, sizeof(tmp_name), "%s.tmp.%d", filename, int(getpid()));
+        FILE* fp = fopen(tmp_name, "wb");
+        bool ok = fp && fwrite(kCMake.data(), 1, kCMake.length(), fp) == kCMake.length();
+        ok = fp && fclose(fp) == 0 && ok;
+#ifdef _WIN32
+        remove(filename);
+#endif
+        if(!ok || rename(tmp_name, filename) != 0) {
+            remove(tmp_name);
+            fprintf(stderr, "failed to open file %s for write\n", filename);
+            return 1;
+        }
+    }
+
+    char cwd[4096];
+    if(!getcwd(cwd, sizeof(cwd))) {
+        return 1;
+    }
+    for(char* ch = cwd; *ch; ++ch) {
+        *ch = *ch == '\\' ? '/' : *ch;
+    }
+    size_t length = strlen(cwd);
+    append(string_view(cwd, length));
+    append(length > 0 && cwd[length - 1] == '/' ? "" : "/");
+    append(filename);
+    append("\n");
+    return write_all(output, output_length) ? 0 : 1;
+}
+}
+
+int main(int argc, char** argv)
+{
+    bool cxxflags = false, rcflags = false, cmake = false, prefix_given = false, config_given = false;
+    unsigned lists[kMaxLists];
+    size_t list_count = 0;
+    for(int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        bool baked_option = false;
+        for(string_view option : kOptions) {
+            baked_option = baked_option || equals(arg, option);
+        }
+        if(baked_option) {
+            continue;
+        } else if(has_prefix(arg, "--prefix")) {
+            if(!same_path(after_equal(arg), kPrefix, true)) {
+                return reject(arg);
+            }
+            prefix_given = true;
+        } else if(has_prefix(arg, "--wxcfg")) {
+            if(!kConfig.empty() && !same_path(after_equal(arg), kConfig, false)) {
+                return reject(arg);
+            }
+            config_given = true;
+        } else if(has_prefix(arg, "--libs")) {
+            const char* list = "std";
+            if(i + 1 < argc && !has_prefix(argv[i + 1], "--")) {
+                list = argv[++i];
+            }
+            if(equals(after_equal(arg), "auto") || list_count == kMaxLists || (list_count > 0 && !kConcatLists)
+               || !parse_libs(list, lists[list_count])) {
+                return reject(arg);
+            }
+            ++list_count;
+        } else if(has_prefix(arg, "--cflags") || has_prefix(arg, "--cxxflags")) {
+            cxxflags = true;
+        } else if(has_prefix(arg, "--rcflags")) {
+            rcflags = true;
+        } else if(has_prefix(arg, "--cmake") && !kCMake.empty()) {
+            cmake = true;
+        } else {
+            return reject(arg);
+        }
+    }
+
+    // the full tools read these when the options are missing
+    const char* wxwin = getenv("WXWIN");
+    if(!prefix_given && wxwin && *wxwin && !same_path(wxwin, kPrefix, true)) {
+        return reject("WXWIN");
+    }
+    const char* wxcfg = getenv("WXCFG");
+    if(!config_given && !kConfig.empty() && wxcfg && *wxcfg && !same_path(wxcfg, kConfig, false)) {
+        return reject("WXCFG");
+    }
+
+    if(cmake) {
+        // the content of wxWidgets.cmake depends on the requested libs, only the default one is baked
+        return list_count > 0 ? reject("--libs") : write_cmake_file();
+    }
+    if(cxxflags) {
+        append(kCflags);
+    } else if(rcflags) {
+        append(kRcflags);
+    } else {
+        append(kLibsHead);
+        if(list_count == 0) {
+            lists[list_count++] = kStd;
+        }
+        for(size_t i = 0; i < list_count; ++i) {
+            for(const auto& lib : kLibs) {
+                if(lists[i] & (1u << (&lib - kLibs))) {
+                    append(lib.args);
+                }
+            }
+        }
+        append("\n");
+    }
+    return write_all(output, output_length) ? 0 : 1;
+}
+)";
+
+/// `str` as a C++ string literal
+string cpp_literal(const string& str)
+{
+    static const char digits[] = "01234567";
+    string result = "\"";
+    for(unsigned char ch : str) {
+        if(ch == '"' || ch == '\\') {
+            result += '\\';
+            result += ch;
+        } else if(ch == '\n') {
+            result += "\\n";
+        } else if(ch < 0x20 || ch >= 0x7f) {
+            // always 3 digits: an octal escape stops there, unlike a hex one
+            result += '\\';
+            result += digits[(ch >> 6) & 7];
+            result += digits[(ch >> 3) & 7];
+            result += digits[ch & 7];
+        } else {
+            result += ch;
+        }
+    }
+    return result + "\"";
+}
+
+string join_args(const vector<string>& args, size_t from = 0)
+{
+    string result;
+    for(size_t i = from; i < args.size(); ++i) {
+        result += args[i] + " ";
+    }
+    return result;
+}
+
+/// `path` absolute, with forward slashes (as write_generated_file() prints it)
+string printable_path(const string& path)
+{
+    error_code ec;
+    string result = filesystem::absolute(path, ec).string();
+    if(ec) {
+        result = path;
+    }
+    replace(result.begin(), result.end(), '\\', '/');
+    return result;
+}
+
+bool is_source_file(const string& path)
+{
+    string ext = filesystem::path(path).extension().string();
+    return ext == ".cpp" || ext == ".cc" || ext == ".cxx";
+}
+}
+
+void bake(const CommandLineParser& parser, const FlagsResolver& resolve, const string& cmake_file)
+{
+    if(parser.is_auto_libs()) {
+        cerr << "--bake can not be combined with --libs=auto: the libs depend on the objects" << endl;
+        fatal_exit(1);
+    }
+
+    WxFlags flags = resolve(expand_libs({}));
+
+    // the link arguments of each library: resolved on its own, the arguments every library has in common are the head
+    // of the line (-L dirs, link flags and, for monolithic builds, the single library)
+    vector<vector<string>> lib_args(kWxLibs.size());
+    for(size_t i = 0; i < kWxLibs.size(); ++i) {
+        lib_args[i] = libs_list(resolve({ string(kWxLibs[i].name) }));
+    }
+    size_t head_length = lib_args[0].size();
+    for(const auto& args : lib_args) {
+        size_t common = 0;
+        while(common < head_length && common < args.size() && args[common] == lib_args[0][common]) {
+            ++common;
+        }
+        head_length = common;
+    }
+    vector<string> head(lib_args[0].begin(), lib_args[0].begin() + head_length);
+
+    // the baked program concatenates the arguments of each library of each list: make sure that gives what the tool
+    // prints. Monolithic builds and --canonical merge the lists instead, these get a single list
+    auto compose = [&](LibSet libs) {
+        string result = join_args(head);
+        for_each_lib(
+            libs, [&](const WxLibInfo& lib) { result += join_args(lib_args[&lib - kWxLibs.data()], head_length); });
+        return result;
+    };
+    vector<pair<string, LibSet>> checks = { { "std", kStdLibs }, { "all", kAllLibs } };
+    for(size_t i = 0; i < kWxLibs.size(); ++i) {
+        checks.push_back({ string(kWxLibs[i].name), close_lib_set(lib_bit(kLibBase) | (LibSet(1) << i)) });
+    }
+    for(const auto& [name, libs] : checks) {
+        if(compose(libs) != format_libs(resolve(expand_libs({ name })))) {
+            cerr << "can not bake the --libs " << name << " output of " << flags.tool << endl;
+            fatal_exit(1);
+        }
+    }
+
+    string prefix = parser.get_prefix();
+    replace(prefix.begin(), prefix.end(), '\\', DIR_SEP);
+    trim(prefix, true, " \t\\/");
+    string config = parser.get_config();
+    replace(config.begin(), config.end(), '\\', DIR_SEP);
+
+    string cflags = format_cflags(flags) + "\n";
+    string rcflags = format_rcflags(flags) + "\n";
+    size_t max_output = max(cflags.length(), rcflags.length()) + 4096 + cmake_file.length();
+    size_t max_libs = join_args(head).length() + 1;
+    for(const auto& args : lib_args) {
+        max_libs += kMaxLists * join_args(args, head_length).length();
+    }
+    max_output = max(max_output, max_libs);
+
+    stringstream ss;
+    ss << "// Generated by " << flags.tool << " --bake, do not edit: https://github.com/eranif/wx-config-msys2\n";
+    ss << "// Answers --cflags, --cxxflags, --rcflags" << (cmake_file.empty() ? "" : ", --cmake")
+       << " and --libs [<list>] for " << prefix << (config.empty() ? "" : " " + config) << "\n";
+    ss << "#include <cstdio>\n";
+    ss << "#include <cstdlib>\n";
+    ss << "#include <cstring>\n";
+    ss << "#include <string_view>\n";
+    ss << "#ifdef _WIN32\n";
+    ss << "#include <direct.h>\n";
+    ss << "#include <io.h>\n";
+    ss << "#include <process.h>\n";
+    ss << "#define getcwd _getcwd\n";
+    ss << "#define getpid _getpid\n";
+    ss << "#else\n";
+    ss << "#include <unistd.h>\n";
+    ss << "#endif\n\n";
+    ss << "using namespace std;\n\n";
+    ss << "namespace\n{\n";
+    ss << "constexpr string_view kTool = " << cpp_literal(flags.tool) << ";\n";
+    ss << "constexpr string_view kPrefix = " << cpp_literal(prefix) << ";\n";
+    ss << "constexpr string_view kConfig = " << cpp_literal(config) << ";\n";
+    ss << "constexpr string_view kCflags = " << cpp_literal(cflags) << ";\n";
+    ss << "constexpr string_view kRcflags = " << cpp_literal(rcflags) << ";\n";
+    ss << "constexpr string_view kCMake = " << cpp_literal(cmake_file) << ";\n";
+    ss << "constexpr string_view kLibsHead = " << cpp_literal(join_args(head)) << ";\n";
+    ss << "constexpr bool kConcatLists = " << (flags.monolithic || parser.is_canonical() ? "false" : "true") << ";\n";
+    ss << "constexpr size_t kMaxLists = " << kMaxLists << ";\n";
+    ss << "constexpr size_t kMaxOutput = " << max_output << ";\n";
+
+    // --no-cache and --debug never change the output
+    ss << "constexpr string_view kOptions[] = { \"--no-cache\", \"--debug\"";
+    for(int i = 1; i < parser.get_argc(); ++i) {
+        string_view arg = parser.get_argv()[i];
+        for(const char* option : kBakedOptions) {
+            if(arg.starts_with(option)) {
+                ss << ", " << cpp_literal(string(arg));
+            }
+        }
+    }
+    ss << " };\n\n";
+
+    ss << "/// the catalog, in link order. `deps` is the library and everything it depends on\n";
+    ss << "struct Lib {\n    string_view name;\n    unsigned deps;\n    string_view args;\n};\n";
+    ss << "constexpr Lib kLibs[] = {\n";
+    for(size_t i = 0; i < kWxLibs.size(); ++i) {
+        ss << "    { " << cpp_literal(string(kWxLibs[i].name)) << ", " << close_lib_set(LibSet(1) << i) << "u, "
+           << cpp_literal(join_args(lib_args[i], head_length)) << " },\n";
+    }
+    ss << "};\n";
+    ss << "constexpr size_t kBase = " << size_t(kLibBase) << ";\n";
+    ss << "constexpr unsigned kStd = " << close_lib_set(kStdLibs) << "u;\n";
+    ss << "constexpr unsigned kAll = " << kAllLibs << "u;\n";
+    ss << kRuntime;
+
+    string out = parser.get_bake_file();
+    string source = is_source_file(out) ? out : out + ".cpp";
+    if(!write_file_if_changed(source, ss.str())) {
+        cerr << "failed to write " << source << endl;
+        fatal_exit(1);
+    }
+    cout << printable_path(source) << endl;
+    if(source == out) {
+        return;
+    }
+
+    string compiler = get_default_pch_compiler(flags);
+    string compiler_path = find_program(compiler);
+    if(compiler_path.empty()) {
+        cerr << "could not find the compiler: " << compiler << endl;
+        fatal_exit(1);
+    }
+    if(run_command({ compiler_path, "-std=c++17", "-O2", source, "-o", out }) != 0) {
+        cerr << "failed to compile " << source << endl;
+        fatal_exit(1);
+    }
+    cout << printable_path(out) << endl;
+}
@@ -0,0 +1,27 @@
+#ifndef BAKE_HPP
+#define BAKE_HPP
+
+#include "utils.hpp"
+#include "wx_flags.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/// the flags of the install for `libs` (lib names, not expanded), with the options of the command line applied
+using FlagsResolver = function<WxFlags(const vector<string>& libs)>;
+
+/**
+ * @brief --bake=<out>: resolve every answer the common queries can get for this prefix (and config) once, and write
+ * them as constexpr tables into a standalone C++ source: --cflags / --cxxflags, --rcflags, --libs with any list (the
+ * link arguments and dependencies of every library are baked, the lists are expanded like the tools do) and, when
+ * `cmake_file` is not empty, --cmake. The program prints its answer with a single write and rejects everything else.
+ *
+ * `out` ending with .cpp / .cc / .cxx gets the source only. Any other `out` is the executable: the source is written
+ * next to it (`<out>.cpp`) and compiled with $CXX (or the compiler matching the wx build). Print the written paths
+ */
+void bake(const CommandLineParser& parser, const FlagsResolver& resolve, const string& cmake_file);
+
+#endif // BAKE_HPP
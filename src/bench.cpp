@@ -0,0 +1,525 @@
+#include "lib_index.hpp"
+#include "local_install.hpp"
+#include "msys2_install.hpp"
+#include "utils.hpp"
+#include "wx_config_api.h"
+#include "wx_flags.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <stdlib.h>
+#else
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+extern char** environ;
+#endif
+
+// Benchmark suite for wx-config / wx-config-msys2.
+//
+// Generates synthetic install trees (MSYS2-style lib dirs with N entries and locally built lib/<cfg>/build.cfg trees
+// for monolithic / split, debug / release builds) and times the individual phases as well as the full process.
+// Every result is printed as one JSON object per line, e.g.:
+//   {"bench":"find_wx_version","layout":"msys2-10000","iterations":50,"mean_us":812.4,"median_us":801.2,...}
+//
+// On Linux, the common queries also run under the libwxconfig-iocount preload shim: the suite fails (exit code 1) when
+// one of them makes more system calls than its budget or lists the install directory more than once.
+//
+// Usage: bench [--entries=100,1000,10000] [--iterations=50] [--process-iterations=20] [--out=<file>] [--keep]
+
+using namespace std;
+
+namespace
+{
+struct Options {
+    vector<size_t> entries = { 100, 1000, 10000 };
+    size_t iterations = 50;
+    size_t process_iterations = 20;
+    string out_file;
+    bool keep = false;
+};
+
+struct LocalLayout {
+    string name;
+    string config;
+    bool monolithic = false;
+    bool debug = false;
+};
+
+const vector<LocalLayout> local_layouts = {
+    { "split-release", "gcc_x64_dll/mswu", false, false },
+    { "split-debug", "gcc_x64_dll/mswud", false, true },
+    { "monolithic-release", "gcc_x64_lib/mswu", true, false },
+    { "monolithic-debug", "gcc_x64_lib/mswud", true, true },
+};
+
+const vector<string> wx_libs = { "xrc", "webview", "stc", "richtext", "ribbon", "propgrid", "aui", "gl", "html", "qa",
+    "core", "xml", "net", "base", "adv", "media" };
+
+ofstream out_stream;
+
+void touch(const string& path) { ofstream(path, ios::binary | ios::trunc); }
+
+/// <root>/lib with the wx 3.2 libraries + filler entries up to `count`, <root>/include/wx-3.2
+void generate_msys2_tree(const string& root, size_t count)
+{
+    string lib_dir = root + "/lib";
+    filesystem::create_directories(lib_dir);
+    filesystem::create_directories(root + "/include/wx-3.2");
+
+    size_t created = 0;
+    for(const auto& lib : wx_libs) {
+        string name = (lib == "base" || lib == "net" || lib == "xml") ? "wx_baseu" : "wx_mswu";
+        if(lib != "base") {
+            name += "_" + lib;
+        }
+        for(const char* ext : { ".a", ".dll.a" }) {
+            touch(lib_dir + "/lib" + name + "-3.2" + ext);
+            ++created;
+        }
+    }
+    for(size_t i = 0; created < count; ++i, ++created) {
+        touch(lib_dir + "/libsynthetic" + to_string(i) + ".dll.a");
+    }
+}
+
+/// <root>/lib/<config>/build.cfg + the matching libraries in <root>/lib/<config root>
+void generate_local_tree(const string& root, const LocalLayout& layout)
+{
+    string cfg_dir = root + "/lib/" + layout.config;
+    string lib_dir = root + "/lib/" + before_first(layout.config, "/");
+    filesystem::create_directories(cfg_dir);
+    filesystem::create_directories(root + "/include");
+
+    ofstream cfg(cfg_dir + "/build.cfg");
+    cfg << "WXVER_MAJOR=3\nWXVER_MINOR=2\nWXVER_RELEASE=4\n";
+    cfg << "BUILD=" << (layout.debug ? "debug" : "release") << "\n";
+    cfg << "MONOLITHIC=" << (layout.monolithic ? "1" : "0") << "\n";
+    cfg << "SHARED=" << (layout.monolithic ? "0" : "1") << "\n";
+    cfg << "UNICODE=1\nTOOLKIT=MSW\nTOOLKIT_VERSION=\nWXUNIV=0\nCFG=\nRUNTIME_LIBS=dynamic\nDEBUG_FLAG=default\n";
+    cfg << "DEBUG_INFO=default\nVENDOR=custom\nOFFICIAL_BUILD=0\nCOMPILER=gcc\nCC=gcc\nCXX=g++\nCFLAGS=\nCPPFLAGS=\n";
+    cfg << "CXXFLAGS=-std=c++17\nLDFLAGS=\n";
+
+    string suffix = layout.debug ? "ud" : "u";
+    if(layout.monolithic) {
+        touch(lib_dir + "/libwxmsw32" + suffix + ".a");
+        touch(lib_dir + "/libwxmsw32" + suffix + "_gl.a");
+        return;
+    }
+    for(const auto& lib : wx_libs) {
+        if(lib == "base") {
+            touch(lib_dir + "/libwxbase32" + suffix + ".a");
+        } else if(lib == "net" || lib == "xml") {
+            touch(lib_dir + "/libwxbase32" + suffix + "_" + lib + ".a");
+        } else {
+            touch(lib_dir + "/libwxmsw32" + suffix + "_" + lib + ".a");
+        }
+    }
+}
+
+/// run `func` `iterations` times and report the timings
+void measure(const string& bench, const string& layout, size_t iterations, const function<void()>& func)
+{
+    vector<double> samples;
+    samples.reserve(iterations);
+    for(size_t i = 0; i < iterations; ++i) {
+        auto start = chrono::steady_clock::now();
+        func();
+        chrono::duration<double, micro> elapsed = chrono::steady_clock::now() - start;
+        samples.push_back(elapsed.count());
+    }
+    sort(samples.begin(), samples.end());
+
+    double total = 0;
+    for(double sample : samples) {
+        total += sample;
+    }
+
+    size_t p95 = min(samples.size() - 1, (samples.size() * 95) / 100);
+    stringstream ss;
+    ss << "{\"bench\":\"" << json_escape(bench) << "\",\"layout\":\"" << json_escape(layout)
+       << "\",\"iterations\":" << iterations << ",\"mean_us\":" << (total / iterations)
+       << ",\"median_us\":" << samples[samples.size() / 2] << ",\"min_us\":" << samples.front()
+       << ",\"p95_us\":" << samples[p95] << ",\"max_us\":" << samples.back() << "}";
+
+    cout << ss.str() << endl;
+    if(out_stream.is_open()) {
+        out_stream << ss.str() << endl;
+    }
+}
+
+/// run an executable with its standard output written to `out_file` (discarded if empty), return its exit code
+int run_process(const vector<string>& args, const string& out_file = "")
+{
+#ifdef _WIN32
+    string command;
+    for(const auto& arg : args) {
+        command += "\"" + arg + "\" ";
+    }
+    command += out_file.empty() ? "> NUL 2>&1" : "> \"" + out_file + "\" 2> NUL";
+    return std::system(command.c_str());
+#else
+    vector<char*> argv;
+    for(const auto& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 1, out_file.empty() ? "/dev/null" : out_file.c_str(),
+        O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY, 0);
+
+    pid_t pid = 0;
+    int rc = posix_spawn(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if(rc != 0) {
+        return -1;
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+#endif
+}
+
+void set_env(const string& name, const string& value)
+{
+#ifdef _WIN32
+    _putenv_s(name.c_str(), value.c_str());
+#else
+    setenv(name.c_str(), value.c_str(), 1);
+#endif
+}
+
+/// time the full process, with the result cache disabled and enabled
+void measure_process(const string& bench, const string& layout, size_t iterations, const vector<string>& args)
+{
+    if(run_process(args) != 0) {
+        cerr << "failed to run: " << args[0] << " on layout " << layout << endl;
+        exit(1);
+    }
+
+    set_env("WXCONFIG_NO_CACHE", "1");
+    measure(bench, layout, iterations, [&]() { run_process(args); });
+    set_env("WXCONFIG_NO_CACHE", "");
+
+    // warm the cache, then measure hits
+    run_process(args);
+    measure(bench + "-cached", layout, iterations, [&]() { run_process(args); });
+}
+
+/// the standard output of `args`
+string capture_process(const vector<string>& args, const string& out_file)
+{
+    run_process(args, out_file);
+    ifstream in_file(out_file, ios::binary);
+    stringstream content;
+    content << in_file.rdbuf();
+    return content.str();
+}
+
+/**
+ * @brief time the lean variant `lean_exe` of the full tool started by `args` (result cache disabled for the full tool,
+ * the lean one has none). Both must print the same bytes
+ */
+void measure_lean_process(
+    const string& bench, const string& layout, size_t iterations, const string& lean_exe, const vector<string>& args)
+{
+    vector<string> lean_args = args;
+    lean_args[0] = lean_exe;
+    string out_file = (filesystem::temp_directory_path() / "wx-config-bench-output").string();
+    set_env("WXCONFIG_NO_CACHE", "1");
+    string expected = capture_process(args, out_file);
+    string actual = capture_process(lean_args, out_file);
+    filesystem::remove(out_file);
+    if(expected != actual) {
+        cerr << lean_exe << " and " << args[0] << " disagree on layout " << layout << ":" << endl
+             << "  " << expected << "  " << actual;
+        exit(1);
+    }
+
+    measure(bench, layout, iterations, [&]() { run_process(args); });
+    measure(bench + "-lean", layout, iterations, [&]() { run_process(lean_args); });
+    set_env("WXCONFIG_NO_CACHE", "");
+}
+
+#ifdef WX_CONFIG_IOCOUNT_LIB
+struct IoCounts {
+    unsigned long long syscalls = 0;
+    unsigned long long dir_entries = 0;
+};
+
+/// the value of `"name":<n>` in a report line of libwxconfig-iocount
+unsigned long long get_report_count(const string& report, const string& name)
+{
+    string pattern = "\"" + name + "\":";
+    size_t pos = report.find(pattern);
+    return pos == string::npos ? 0 : stoull(report.substr(pos + pattern.length()));
+}
+
+/**
+ * @brief count the system calls of the process started by `args` with the preload shim and fail the suite when they
+ * exceed `syscall_budget`, or when the install directory is listed more than once (more than `entries` + . and ..).
+ * The budgets do not depend on the size of the install: a query must not get more expensive as the install grows
+ */
+IoCounts measure_io(const string& bench, const string& layout, const vector<string>& args,
+    unsigned long long syscall_budget, unsigned long long entries)
+{
+    string report_file = (filesystem::temp_directory_path() / "wx-config-bench-io.jsonl").string();
+    filesystem::remove(report_file);
+    set_env("WXCONFIG_IO_REPORT", report_file);
+    set_env("LD_PRELOAD", WX_CONFIG_IOCOUNT_LIB);
+    int rc = run_process(args);
+    set_env("LD_PRELOAD", "");
+    set_env("WXCONFIG_IO_REPORT", "");
+
+    ifstream in_file(report_file, ios::binary);
+    string report;
+    getline(in_file, report);
+    in_file.close();
+    filesystem::remove(report_file);
+    if(rc != 0 || report.empty()) {
+        cerr << "failed to count the system calls of: " << args[0] << " on layout " << layout << endl;
+        exit(1);
+    }
+
+    unsigned long long syscalls = get_report_count(report, "syscalls");
+    unsigned long long dir_entries = get_report_count(report, "dir_entries");
+    stringstream ss;
+    ss << "{\"bench\":\"" << json_escape(bench) << "\",\"layout\":\"" << json_escape(layout)
+       << "\",\"syscalls\":" << syscalls << ",\"syscall_budget\":" << syscall_budget
+       << ",\"dir_entries\":" << dir_entries << ",\"bytes_read\":" << get_report_count(report, "bytes_read") << "}";
+    cout << ss.str() << endl;
+    if(out_stream.is_open()) {
+        out_stream << ss.str() << endl;
+    }
+
+    if(syscalls > syscall_budget || dir_entries > entries + 2) {
+        cerr << bench << " on layout " << layout << " is over its I/O budget: " << syscalls << " system calls (budget "
+             << syscall_budget << "), " << dir_entries << " directory entries read (budget " << entries + 2 << ")"
+             << endl;
+        exit(1);
+    }
+    return { syscalls, dir_entries };
+}
+
+/**
+ * @brief the I/O budgets of a common query: the full tool without and with the result cache, and its lean variant. A
+ * cache hit must also cost less than the query it saves: no more system calls, unless the query lists the install
+ * (which grows with it)
+ */
+void measure_query_io(const string& bench, const string& layout, const string& lean_exe, const vector<string>& args,
+    unsigned long long entries)
+{
+    set_env("WXCONFIG_NO_CACHE", "1");
+    IoCounts uncached = measure_io(bench, layout, args, 8, entries);
+    vector<string> lean_args = args;
+    lean_args[0] = lean_exe;
+    measure_io(bench + "-lean", layout, lean_args, 6, entries);
+    set_env("WXCONFIG_NO_CACHE", "");
+
+    // the first run fills the cache
+    run_process(args);
+    IoCounts cached = measure_io(bench + "-cached", layout, args, 12, 0);
+    if(cached.syscalls > uncached.syscalls && uncached.dir_entries == 0) {
+        cerr << bench << " on layout " << layout << " costs more with the result cache: " << cached.syscalls
+             << " system calls, against " << uncached.syscalls << " without" << endl;
+        exit(1);
+    }
+}
+#endif
+
+Options parse_options(int argc, char** argv)
+{
+    Options options;
+    for(int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        string value = after_first(arg, "=");
+        if(arg.starts_with("--entries=")) {
+            options.entries.clear();
+            istringstream iss(value);
+            string count;
+            while(getline(iss, count, ',')) {
+                options.entries.push_back(stoul(count));
+            }
+        } else if(arg.starts_with("--iterations=")) {
+            options.iterations = max<size_t>(1, stoul(value));
+        } else if(arg.starts_with("--process-iterations=")) {
+            options.process_iterations = stoul(value);
+        } else if(arg.starts_with("--out=")) {
+            options.out_file = value;
+        } else if(arg == "--keep") {
+            options.keep = true;
+        } else {
+            cerr << "usage: bench [--entries=100,1000,10000] [--iterations=50] [--process-iterations=20] "
+                    "[--out=<file>] [--keep]"
+                 << endl;
+            exit(1);
+        }
+    }
+    return options;
+}
+}
+
+int main(int argc, char** argv)
+{
+    Options options = parse_options(argc, argv);
+    if(!options.out_file.empty()) {
+        out_stream.open(options.out_file, ios::app);
+    }
+
+    string root = (filesystem::temp_directory_path() / "wx-config-bench").string();
+    replace(root.begin(), root.end(), '\\', '/');
+    filesystem::remove_all(root);
+
+    // the benchmarks measure the install tree scans, never the server nor a stale cache
+    set_env("WXCONFIG_NO_SERVER", "1");
+    set_env("XDG_CACHE_HOME", root + "/cache");
+    set_env("WXVER", "");
+    set_env("WXWIN", "");
+    set_env("WXCFG", "");
+
+    // parse_args
+    {
+        string prefix_arg = "--prefix=" + root + "/local";
+        vector<string> args = { "wx-config", prefix_arg, "--wxcfg=gcc_x64_dll/mswu", "--libs", "all", "--cflags" };
+        vector<char*> argv_vec;
+        for(auto& arg : args) {
+            argv_vec.push_back(arg.data());
+        }
+        int parser_argc = static_cast<int>(argv_vec.size());
+        CommandLineParser parser(parser_argc, argv_vec.data());
+        measure("parse_args", "cmdline", options.iterations * 100, [&]() { parser.parse_args(true); });
+    }
+
+    // MSYS2 layouts
+    for(size_t count : options.entries) {
+        string tree = root + "/msys2-" + to_string(count);
+        string layout = "msys2-" + to_string(count);
+        generate_msys2_tree(tree, count);
+
+        measure("find_wx_version", layout, options.iterations, [&]() {
+            reset_msys2_state();
+            find_wx_version(tree + "/lib");
+        });
+        measure("lib_index", layout, options.iterations, [&]() {
+            reset_lib_index_state();
+            get_lib_index(tree + "/lib");
+        });
+
+        if(options.process_iterations > 0) {
+            measure_process("process-msys2-cflags", layout, options.process_iterations,
+                { WX_CONFIG_MSYS2_EXE, "--prefix=" + tree, "--cflags" });
+            measure_process("process-msys2-libs", layout, options.process_iterations,
+                { WX_CONFIG_MSYS2_EXE, "--prefix=" + tree, "--libs", "all" });
+            measure_process("process-msys2-libs-absolute", layout, options.process_iterations,
+                { WX_CONFIG_MSYS2_EXE, "--prefix=" + tree, "--libs", "std", "--absolute" });
+            measure_lean_process("startup-msys2-cflags", layout, options.process_iterations, WX_CONFIG_MSYS2_LEAN_EXE,
+                { WX_CONFIG_MSYS2_EXE, "--prefix=" + tree, "--cflags" });
+            measure_lean_process("startup-msys2-libs", layout, options.process_iterations, WX_CONFIG_MSYS2_LEAN_EXE,
+                { WX_CONFIG_MSYS2_EXE, "--prefix=" + tree, "--libs", "all" });
+        }
+#ifdef WX_CONFIG_IOCOUNT_LIB
+        measure_query_io("io-msys2-cflags", layout, WX_CONFIG_MSYS2_LEAN_EXE,
+            { WX_CONFIG_MSYS2_EXE, "--prefix=" + tree, "--cflags" }, count);
+        measure_query_io("io-msys2-libs", layout, WX_CONFIG_MSYS2_LEAN_EXE,
+            { WX_CONFIG_MSYS2_EXE, "--prefix=" + tree, "--libs", "all" }, count);
+#endif
+    }
+
+    // locally built layouts
+    string local_root = root + "/local";
+    for(const auto& layout : local_layouts) {
+        generate_local_tree(local_root, layout);
+    }
+
+    for(const auto& layout : local_layouts) {
+        // the first run writes the snapshot, the text variant skips it
+        measure("parse_build_cfg", layout.name, options.iterations, [&]() {
+            reset_local_state();
+            parse_build_cfg(local_root, layout.config);
+        });
+        set_env("WXCONFIG_NO_SNAPSHOT", "1");
+        measure("parse_build_cfg-text", layout.name, options.iterations, [&]() {
+            reset_local_state();
+            parse_build_cfg(local_root, layout.config);
+        });
+        set_env("WXCONFIG_NO_SNAPSHOT", "");
+
+        string prefix_arg = "--prefix=" + local_root;
+        string config_arg = "--wxcfg=" + layout.config;
+        vector<char*> argv_vec = { argv[0], prefix_arg.data(), config_arg.data(), const_cast<char*>("--libs"),
+            const_cast<char*>("all") };
+        int parser_argc = static_cast<int>(argv_vec.size());
+        CommandLineParser parser(parser_argc, argv_vec.data());
+        parser.parse_args(true);
+        measure("add_libs", layout.name, options.iterations * 100, [&]() {
+            WxFlags flags;
+            add_libs(get_build_cfg(), parser.get_libs(), layout.config, local_root, flags);
+        });
+
+        // what an IDE linking the library pays per query, once its context is created
+        wx_config_context* context = nullptr;
+        if(wx_config_context_create(WX_CONFIG_INSTALL_LOCAL, local_root.c_str(), layout.config.c_str(), &context)
+           == WX_CONFIG_OK) {
+            wx_config_query_options query_options = { "all", 0, 0, 0 };
+            measure("capi_query", layout.name, options.iterations * 100, [&]() {
+                wx_config_result* result = nullptr;
+                wx_config_query(context, &query_options, &result);
+                wx_config_result_destroy(result);
+            });
+            wx_config_context_destroy(context);
+        }
+
+        if(options.process_iterations > 0) {
+            measure_process("process-local-cflags", layout.name, options.process_iterations,
+                { WX_CONFIG_EXE, prefix_arg, config_arg, "--cflags" });
+            measure_process("process-local-libs", layout.name, options.process_iterations,
+                { WX_CONFIG_EXE, prefix_arg, config_arg, "--libs", "all" });
+            measure_lean_process("startup-local-cflags", layout.name, options.process_iterations, WX_CONFIG_LEAN_EXE,
+                { WX_CONFIG_EXE, prefix_arg, config_arg, "--cflags" });
+            measure_lean_process("startup-local-libs", layout.name, options.process_iterations, WX_CONFIG_LEAN_EXE,
+                { WX_CONFIG_EXE, prefix_arg, config_arg, "--libs", "all" });
+        }
+#ifdef WX_CONFIG_IOCOUNT_LIB
+        measure_query_io("io-local-cflags", layout.name, WX_CONFIG_LEAN_EXE,
+            { WX_CONFIG_EXE, prefix_arg, config_arg, "--cflags" }, 0);
+        measure_query_io("io-local-libs", layout.name, WX_CONFIG_LEAN_EXE,
+            { WX_CONFIG_EXE, prefix_arg, config_arg, "--libs", "all" }, 0);
+#endif
+    }
+
+    // every layout in one pass, parsed concurrently (what --manifest does)
+    {
+        string prefix_arg = "--prefix=" + local_root;
+        vector<char*> argv_vec = { argv[0], prefix_arg.data(), const_cast<char*>("--manifest") };
+        int parser_argc = static_cast<int>(argv_vec.size());
+        CommandLineParser parser(parser_argc, argv_vec.data());
+        parser.parse_args(true);
+        measure("resolve_all_local_flags", "all", options.iterations, [&]() {
+            resolve_all_local_flags(parser.get_libs(), local_root, find_local_configs(local_root));
+        });
+        if(options.process_iterations > 0) {
+            measure_process("process-local-manifest", "all", options.process_iterations,
+                { WX_CONFIG_EXE, prefix_arg, "--manifest" });
+        }
+    }
+
+    if(!options.keep) {
+        filesystem::remove_all(root);
+    } else {
+        cerr << "synthetic install trees kept under: " << root << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,174 @@
+#include "utils.hpp"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <string>
+#include <vector>
+
+// Micro-benchmark: compare the std::regex based wxWidgets version detection (the original find_wx_version) with the
+// hand-rolled match_wx_base_version() scanner on a synthetic MSYS2-like lib dir.
+//
+// Usage: bench-version-scan [entries=10000] [iterations=20]
+
+using namespace std;
+
+namespace
+{
+struct ScanResult {
+    size_t weight = 0;
+    string major;
+    string minor;
+
+    bool operator==(const ScanResult& other) const
+    {
+        return weight == other.weight && major == other.major && minor == other.minor;
+    }
+};
+
+/// the original implementation
+ScanResult scan_regex(const vector<string>& paths)
+{
+    ScanResult result;
+    regex re("libwx_baseu\\-([\\d]+)[\\.]{1}([\\d]+)");
+    for(const auto& path : paths) {
+        if(path.find("libwx_baseu-") != string::npos) {
+            smatch m;
+            if(regex_search(path, m, re)) {
+                string tmp_major = m[1];
+                string tmp_minor = m[2];
+                size_t weight = (atoi(tmp_major.c_str()) * 100) + (atoi(tmp_minor.c_str()) * 10);
+                if(weight > result.weight) {
+                    result.major.swap(tmp_major);
+                    result.minor.swap(tmp_minor);
+                    result.weight = weight;
+                }
+            }
+        }
+    }
+    return result;
+}
+
+ScanResult scan_matcher(const vector<string>& paths)
+{
+    ScanResult result;
+    for(const auto& path : paths) {
+        string_view major, minor;
+        if(match_wx_base_version(path, major, minor)) {
+            size_t weight = wx_version_weight(major, minor);
+            if(weight > result.weight) {
+                result.major = major;
+                result.minor = minor;
+                result.weight = weight;
+            }
+        }
+    }
+    return result;
+}
+
+/// list the directory the way find_wx_version does
+vector<string> list_dir(const string& dir)
+{
+    vector<string> paths;
+    for(const auto& entry : filesystem::directory_iterator(dir)) {
+        paths.push_back(entry.path().string());
+    }
+    return paths;
+}
+
+/// populate `dir` with `count` entries, a few of them wx libraries of different versions
+void generate_lib_dir(const string& dir, size_t count)
+{
+    filesystem::remove_all(dir);
+    filesystem::create_directories(dir);
+
+    const char* versions[] = { "3.0", "3.1", "3.2", "3.10" };
+    const char* wx_libs[] = { "baseu", "baseu_net", "baseu_xml", "mswu_core", "mswu_adv", "mswu_aui" };
+    size_t created = 0;
+    for(const char* ver : versions) {
+        for(const char* lib : wx_libs) {
+            for(const char* ext : { ".a", ".dll.a" }) {
+                ofstream(dir + "/libwx_" + lib + "-" + ver + ext);
+                ++created;
+            }
+        }
+    }
+    // decoys
+    for(const char* name : { "libwx_baseu-.a", "libwx_baseu-3.a", "libwx_baseu-x.2.a", "libwx_baseu-3..2.a" }) {
+        ofstream(dir + "/" + name);
+        ++created;
+    }
+    for(size_t i = 0; created < count; ++i, ++created) {
+        ofstream(dir + "/libsynthetic" + to_string(i) + ".dll.a");
+    }
+}
+
+template <typename Func> double time_it(size_t iterations, Func func)
+{
+    auto start = chrono::steady_clock::now();
+    for(size_t i = 0; i < iterations; ++i) {
+        func();
+    }
+    chrono::duration<double, micro> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+/// make sure both implementations agree on tricky inputs
+bool check_equivalence()
+{
+    vector<vector<string>> cases = {
+        { "/lib/libwx_baseu-3.2.a" },
+        { "/lib/libwx_baseu-3.2.a", "/lib/libwx_baseu-3.10.a" },
+        { "/lib/libwx_baseu-.a", "/lib/libwx_baseu-3.a", "/lib/libwx_baseu-3.", "/lib/libwx_baseu-.3" },
+        { "/lib/libwx_baseu-x libwx_baseu-4.1" },
+        { "/lib/libwx_baseu-3.1libwx_baseu-3.2" },
+        { "/lib/libwx_baseu-03.02.dll.a", "/lib/libwx_baseu-3.2.dll.a" },
+        { "/lib/libwx_baseu-3-2.a", "/lib/libwx_baseu_xml-3.2.a" },
+        { "libwx_baseu-12.345" },
+        {},
+    };
+    for(const auto& paths : cases) {
+        if(!(scan_regex(paths) == scan_matcher(paths))) {
+            cerr << "mismatch for case starting with: " << (paths.empty() ? "<empty>" : paths[0]) << endl;
+            return false;
+        }
+    }
+    return true;
+}
+}
+
+int main(int argc, char** argv)
+{
+    size_t entries = argc > 1 ? stoul(argv[1]) : 10000;
+    size_t iterations = argc > 2 ? stoul(argv[2]) : 20;
+
+    if(!check_equivalence()) {
+        return 1;
+    }
+
+    string dir = (filesystem::temp_directory_path() / "wx-config-bench-version-scan").string();
+    generate_lib_dir(dir, entries);
+
+    auto paths = list_dir(dir);
+    if(!(scan_regex(paths) == scan_matcher(paths))) {
+        cerr << "regex and matcher disagree on the synthetic lib dir" << endl;
+        return 1;
+    }
+
+    ScanResult sink;
+    double regex_us = time_it(iterations, [&]() { sink = scan_regex(paths); });
+    double matcher_us = time_it(iterations, [&]() { sink = scan_matcher(paths); });
+    double regex_dir_us = time_it(iterations, [&]() { sink = scan_regex(list_dir(dir)); });
+    double matcher_dir_us = time_it(iterations, [&]() { sink = scan_matcher(list_dir(dir)); });
+
+    cout << "entries: " << paths.size() << ", iterations: " << iterations << ", version: " << sink.major << "."
+         << sink.minor << endl;
+    cout << "regex   (match only)        : " << regex_us << " us" << endl;
+    cout << "matcher (match only)        : " << matcher_us << " us" << endl;
+    cout << "regex   (directory + match) : " << regex_dir_us << " us" << endl;
+    cout << "matcher (directory + match) : " << matcher_dir_us << " us" << endl;
+
+    filesystem::remove_all(dir);
+    return 0;
+}
@@ -0,0 +1,205 @@
+#include "build_cfg.hpp"
+
+#include "utils.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+namespace
+{
+/// bump the last char when the layout below changes
+constexpr char kSnapshotMagic[8] = { 'W', 'X', 'C', 'F', 'G', 'S', 'N', '1' };
+
+struct SnapshotHeader {
+    char magic[8];
+    int64_t mtime;      // of build.cfg
+    uint64_t size;      // of build.cfg
+    uint32_t count;     // number of SnapshotEntry following the header
+    uint32_t blob_size; // size of the string data following the entries
+};
+
+struct SnapshotEntry {
+    uint32_t key_offset;
+    uint32_t key_length;
+    uint32_t value_offset;
+    uint32_t value_length;
+};
+
+bool snapshots_enabled() { return safe_getenv("WXCONFIG_NO_SNAPSHOT").empty(); }
+}
+
+void BuildCfg::clear()
+{
+    m_entries.clear();
+    m_file.reset();
+    m_from_snapshot = false;
+}
+
+string_view BuildCfg::get(string_view key) const
+{
+    for(const auto& [k, v] : m_entries) {
+        if(k == key) {
+            return v;
+        }
+    }
+    return {};
+}
+
+bool BuildCfg::contains(string_view key) const
+{
+    for(const auto& entry : m_entries) {
+        if(entry.first == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void BuildCfg::parse_text(string_view content)
+{
+    constexpr string_view trim_chars = "\r\n\t\v ";
+    while(!content.empty()) {
+        size_t eol = content.find('\n');
+        string_view line = content.substr(0, eol);
+        content = eol == string_view::npos ? string_view() : content.substr(eol + 1);
+
+        // trim from the right, like trim() does
+        size_t last = line.find_last_not_of(trim_chars);
+        line = last == string_view::npos ? string_view() : line.substr(0, last + 1);
+
+        size_t eq = line.find('=');
+        if(eq == string_view::npos) {
+            continue;
+        }
+        string_view key = line.substr(0, eq);
+        if(!contains(key)) {
+            m_entries.push_back({ key, line.substr(eq + 1) });
+        }
+    }
+}
+
+bool BuildCfg::load_snapshot(const string& snapshot_path, const FileStamp& stamp)
+{
+    auto file = make_shared<MappedFile>();
+    if(!file->open(snapshot_path)) {
+        return false;
+    }
+
+    string_view data = file->view();
+    SnapshotHeader header;
+    if(data.length() < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    if(memcmp(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0 || header.mtime != stamp.mtime
+       || header.size != stamp.size) {
+        return false;
+    }
+
+    size_t entries_size = size_t(header.count) * sizeof(SnapshotEntry);
+    if(data.length() != sizeof(header) + entries_size + header.blob_size) {
+        return false;
+    }
+
+    string_view blob = data.substr(sizeof(header) + entries_size);
+    vector<Entry> entries;
+    entries.reserve(header.count);
+    for(uint32_t i = 0; i < header.count; ++i) {
+        SnapshotEntry entry;
+        memcpy(&entry, data.data() + sizeof(header) + i * sizeof(SnapshotEntry), sizeof(entry));
+        if(size_t(entry.key_offset) + entry.key_length > blob.length()
+           || size_t(entry.value_offset) + entry.value_length > blob.length()) {
+            return false;
+        }
+        entries.push_back(
+            { blob.substr(entry.key_offset, entry.key_length), blob.substr(entry.value_offset, entry.value_length) });
+    }
+
+    m_file = file;
+    m_entries.swap(entries);
+    m_from_snapshot = true;
+    return true;
+}
+
+void BuildCfg::write_snapshot(const string& snapshot_path, const FileStamp& stamp) const
+{
+    SnapshotHeader header;
+    memcpy(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic));
+    header.mtime = stamp.mtime;
+    header.size = stamp.size;
+    header.count = static_cast<uint32_t>(m_entries.size());
+
+    vector<SnapshotEntry> entries;
+    string blob;
+    for(const auto& [key, value] : m_entries) {
+        SnapshotEntry entry;
+        entry.key_offset = static_cast<uint32_t>(blob.length());
+        entry.key_length = static_cast<uint32_t>(key.length());
+        blob.append(key);
+        entry.value_offset = static_cast<uint32_t>(blob.length());
+        entry.value_length = static_cast<uint32_t>(value.length());
+        blob.append(value);
+        entries.push_back(entry);
+    }
+    header.blob_size = static_cast<uint32_t>(blob.length());
+
+    // write-to-temp + rename: a concurrent reader sees either no snapshot or a complete one
+    random_device rd;
+    string tmp_path = snapshot_path + ".tmp." + to_hex((uint64_t(rd()) << 32) | rd());
+    {
+        ofstream out_file(tmp_path, ios::binary | ios::trunc);
+        if(!out_file.good()) {
+            return;
+        }
+        out_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out_file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(SnapshotEntry));
+        out_file.write(blob.data(), blob.length());
+        if(!out_file.good()) {
+            out_file.close();
+            error_code ec;
+            filesystem::remove(tmp_path, ec);
+            return;
+        }
+    }
+
+    error_code ec;
+    filesystem::rename(tmp_path, snapshot_path, ec);
+    if(ec) {
+        filesystem::remove(tmp_path, ec);
+    }
+}
+
+BuildCfg::eLoadResult BuildCfg::load(const string& path)
+{
+    clear();
+    FileStamp stamp = get_file_stamp(path);
+    if(!stamp.exists) {
+        return kLoadNotFound;
+    }
+
+    bool use_snapshot = snapshots_enabled();
+    string snapshot_path = path + ".snapshot";
+    if(use_snapshot && load_snapshot(snapshot_path, stamp)) {
+        return kLoadOk;
+    }
+
+    auto file = make_shared<MappedFile>();
+    if(!file->open(path)) {
+        return kLoadNotFound;
+    }
+    m_file = file;
+    parse_text(m_file->view());
+
+    for(const auto& key : kRequiredKeys) {
+        if(!contains(key)) {
+            return kLoadMissingKeys;
+        }
+    }
+
+    if(use_snapshot) {
+        write_snapshot(snapshot_path, stamp);
+    }
+    return kLoadOk;
+}
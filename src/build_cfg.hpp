@@ -0,0 +1,61 @@
+#ifndef BUILD_CFG_HPP
+#define BUILD_CFG_HPP
+
+#include "mapped_file.hpp"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief the content of a wxWidgets build.cfg file (every KEY=VALUE line)
+ *
+ * The file is memory mapped and the entries are views into the mapping, so parsing does not copy the keys or values.
+ * After a successful parse, a compact binary snapshot (`build.cfg.snapshot`) is written next to the file. Later loads
+ * map the snapshot directly instead of parsing the text, as long as the mtime and size of build.cfg recorded in it
+ * still match. The snapshot is best effort: read-only install trees simply always parse the text. Set
+ * WXCONFIG_NO_SNAPSHOT=1 to neither read nor write snapshots
+ */
+class BuildCfg
+{
+public:
+    typedef pair<string_view, string_view> Entry;
+
+    enum eLoadResult {
+        kLoadOk,
+        kLoadNotFound,
+        kLoadMissingKeys,
+    };
+
+    /// the keys every build.cfg must define
+    static constexpr string_view kRequiredKeys[] = { "WXVER_MAJOR", "WXVER_MINOR", "WXVER_RELEASE", "CXXFLAGS",
+        "BUILD", "MONOLITHIC", "VENDOR", "COMPILER" };
+
+protected:
+    shared_ptr<MappedFile> m_file; // owns the bytes the entries point into
+    vector<Entry> m_entries;
+    bool m_from_snapshot = false;
+
+    void parse_text(string_view content);
+    bool load_snapshot(const string& snapshot_path, const FileStamp& stamp);
+    void write_snapshot(const string& snapshot_path, const FileStamp& stamp) const;
+
+public:
+    /**
+     * @brief load `path` (a build.cfg file), using its snapshot when up to date
+     */
+    eLoadResult load(const string& path);
+
+    /// the value of `key`, or an empty view if the key does not exist. The first occurrence of a key wins
+    string_view get(string_view key) const;
+    bool contains(string_view key) const;
+    const vector<Entry>& entries() const { return m_entries; }
+    bool is_from_snapshot() const { return m_from_snapshot; }
+    void clear();
+};
+
+#endif // BUILD_CFG_HPP
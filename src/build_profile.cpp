@@ -0,0 +1,214 @@
+#include "build_profile.hpp"
+
+#include "cache.hpp"
+#include "mapped_file.hpp"
+#include "utils.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <unordered_map>
+
+namespace
+{
+/// bump this when the probe or the layout of the index changes
+constexpr const char* kToolchainFormat = "wx-config-toolchain-1";
+
+enum FlagKind {
+    kCompileFlag,
+    kLinkFlag,
+    kCompileAndLinkFlag, // e.g. -flto, needed on both command lines
+};
+
+struct ProfileFlag {
+    string flag;
+    FlagKind kind;
+};
+
+string stamp_of(const string& path)
+{
+    FileStamp stamp = get_file_stamp(path);
+    if(!stamp.exists) {
+        return "-";
+    }
+    return to_string(stamp.mtime) + ":" + to_string(stamp.size);
+}
+
+bool is_clang(const string& compiler)
+{
+    return filesystem::path(compiler).filename().string().find("clang") != string::npos;
+}
+
+/// the flags `profile` asks for, before checking them against the compiler
+vector<ProfileFlag> get_profile_flags(BuildProfile profile, bool clang, bool shared)
+{
+    vector<ProfileFlag> result;
+    switch(profile) {
+    case BuildProfile::kNone:
+        return result;
+    case BuildProfile::kFastLink:
+        result = { { "-fuse-ld=lld", kLinkFlag } };
+        break;
+    case BuildProfile::kLto:
+        // GCC has no thin LTO, -flto=auto runs the LTO jobs in parallel instead
+        result = { { clang ? "-flto=thin" : "-flto=auto", kCompileAndLinkFlag },
+            { "-ffunction-sections", kCompileFlag }, { "-fdata-sections", kCompileFlag },
+            { "-Wl,--gc-sections", kLinkFlag } };
+        if(clang) {
+            // thin LTO needs the LLVM linker
+            result.push_back({ "-fuse-ld=lld", kLinkFlag });
+        }
+        break;
+    case BuildProfile::kFastDebug:
+        result = { { "-Og", kCompileFlag }, { "-g", kCompileFlag }, { "-gsplit-dwarf", kCompileFlag },
+            { "-fuse-ld=lld", kLinkFlag } };
+        break;
+    }
+    // only the DLLs actually used are recorded. Static archives are not affected, the flag buys nothing there
+    if(shared) {
+        result.push_back({ "-Wl,--as-needed", kLinkFlag });
+    }
+    return result;
+}
+
+/// where the answers for `compiler_path` are remembered, empty when the cache is disabled
+string get_index_path(const string& compiler_path)
+{
+    if(!safe_getenv("WXCONFIG_NO_CACHE").empty()) {
+        return "";
+    }
+    string dir = get_cache_dir();
+    if(dir.empty()) {
+        return "";
+    }
+    stringstream key;
+    key << kToolchainFormat << '\0' << compiler_path << '\0' << stamp_of(compiler_path);
+    return dir + DIR_SEP + "toolchain" + DIR_SEP + to_hex(fnv1a_64(key.str()));
+}
+
+/// `<1 or 0> <flag>` lines: whether the compiler accepts the flag
+unordered_map<string, bool> read_index(const string& index_path)
+{
+    unordered_map<string, bool> known;
+    ifstream in_file(index_path, ios::binary);
+    string line;
+    if(!getline(in_file, line) || line != kToolchainFormat) {
+        return known;
+    }
+    while(getline(in_file, line)) {
+        if(line.length() > 2 && line[1] == ' ') {
+            known[line.substr(2)] = line[0] == '1';
+        }
+    }
+    return known;
+}
+
+void write_index(const string& index_path, const unordered_map<string, bool>& known)
+{
+    vector<string> lines;
+    for(const auto& [flag, supported] : known) {
+        lines.push_back((supported ? "1 " : "0 ") + flag);
+    }
+    // a stable content, so an unchanged index is not rewritten
+    sort(lines.begin(), lines.end());
+    stringstream ss;
+    ss << kToolchainFormat << "\n";
+    for(const auto& line : lines) {
+        ss << line << "\n";
+    }
+    error_code ec;
+    filesystem::create_directories(filesystem::path(index_path).parent_path(), ec);
+    write_file_if_changed(index_path, ss.str());
+}
+
+/// a scratch directory holding the test source, removed by the destructor
+class ProbeDir
+{
+    string m_path;
+
+public:
+    ~ProbeDir()
+    {
+        if(!m_path.empty()) {
+            error_code ec;
+            filesystem::remove_all(m_path, ec);
+        }
+    }
+
+    const string& get()
+    {
+        if(m_path.empty()) {
+            random_device rd;
+            m_path = (filesystem::temp_directory_path() / ("wx-config-probe-" + to_hex((uint64_t(rd()) << 32) | rd())))
+                         .string();
+            error_code ec;
+            filesystem::create_directories(m_path, ec);
+            ofstream(m_path + DIR_SEP + "probe.cpp", ios::binary | ios::trunc) << "int main() { return 0; }\n";
+        }
+        return m_path;
+    }
+};
+
+/// compile (and link, for link flags) the test source with `flag`. -Werror: a flag the compiler only warns about,
+/// such as an unsupported debug format, is not supported either
+bool try_flag(const string& compiler_path, const ProfileFlag& flag, ProbeDir& probe_dir)
+{
+    const string& dir = probe_dir.get();
+    vector<string> command = { compiler_path, "-Werror", flag.flag };
+    if(flag.kind == kCompileFlag) {
+        command.insert(command.end(), { "-c", dir + DIR_SEP + "probe.cpp", "-o", dir + DIR_SEP + "probe.o" });
+    } else {
+        command.insert(command.end(), { dir + DIR_SEP + "probe.cpp", "-o", dir + DIR_SEP + "probe.exe" });
+    }
+    return run_command(command, true) == 0;
+}
+}
+
+bool parse_build_profile(const string& name, BuildProfile& profile)
+{
+    static const unordered_map<string, BuildProfile> kProfiles = { { "fastlink", BuildProfile::kFastLink },
+        { "lto", BuildProfile::kLto }, { "fastdebug", BuildProfile::kFastDebug } };
+    auto iter = kProfiles.find(name);
+    if(iter == kProfiles.end()) {
+        return false;
+    }
+    profile = iter->second;
+    return true;
+}
+
+void apply_build_profile(BuildProfile profile, const string& compiler, WxFlags& flags)
+{
+    if(profile == BuildProfile::kNone) {
+        return;
+    }
+    string compiler_path = find_program(compiler);
+    if(compiler_path.empty()) {
+        cerr << "could not find the compiler: " << compiler << ", the build profile flags are left out" << endl;
+        return;
+    }
+
+    string index_path = get_index_path(compiler_path);
+    unordered_map<string, bool> known = read_index(index_path);
+    bool probed = false;
+    ProbeDir probe_dir;
+    for(const auto& flag : get_profile_flags(profile, is_clang(compiler_path), flags.shared)) {
+        auto iter = known.find(flag.flag);
+        if(iter == known.end()) {
+            iter = known.emplace(flag.flag, try_flag(compiler_path, flag, probe_dir)).first;
+            probed = true;
+        }
+        if(!iter->second) {
+            continue;
+        }
+        if(flag.kind != kLinkFlag) {
+            flags.profile_flags.push_back(flag.flag);
+        }
+        if(flag.kind != kCompileFlag) {
+            flags.link_flags.push_back(flag.flag);
+        }
+    }
+    if(probed && !index_path.empty()) {
+        write_index(index_path, known);
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef BUILD_PROFILE_HPP
+#define BUILD_PROFILE_HPP
+
+#include "wx_flags.hpp"
+
+#include <string>
+
+using namespace std;
+
+/// --profile=<name>: extra compile and link flags tuned for a kind of build
+enum class BuildProfile {
+    kNone,
+    kFastLink,  // iterative builds: link with lld, drop the unused DLLs
+    kLto,       // release links: (thin) LTO and section garbage collection
+    kFastDebug, // debug builds: -Og, split debug info, fast link
+};
+
+/// "fastlink", "lto" or "fastdebug" -> the profile. False if `name` is none of them
+bool parse_build_profile(const string& name, BuildProfile& profile);
+
+/**
+ * @brief add the flags of `profile` to `flags` (compile flags to --cflags, after the CXXFLAGS of build.cfg so that -Og
+ * wins over a -O2 there, link flags to --libs), keeping only the ones `compiler` accepts. Each flag is tried once per
+ * compiler with a tiny test build; the answers are remembered under <cache dir>/toolchain, keyed on the compiler path,
+ * mtime and size. Nothing is added (and a warning is printed) when the compiler can not be found
+ */
+void apply_build_profile(BuildProfile profile, const string& compiler, WxFlags& flags);
+
+#endif // BUILD_PROFILE_HPP
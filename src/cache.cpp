@@ -0,0 +1,221 @@
+#include "cache.hpp"
+
+#include "mapped_file.hpp"
+#include "shared_result_table.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace
+{
+/// the layout of the cache entry. Bump this when the file format changes
+constexpr const char* kCacheFormat = "wx-config-cache-3";
+
+/// past this many entries, store() removes the oldest ones down to 3/4 of it, so it does not prune on every call
+constexpr size_t kMaxEntries = 512;
+
+/// the path to the running executable, used to invalidate entries written by an older build of the tool
+string get_self_path(const char* argv0)
+{
+#ifdef _WIN32
+    char buffer[MAX_PATH] = { 0 };
+    DWORD len = ::GetModuleFileNameA(nullptr, buffer, MAX_PATH);
+    if(len > 0 && len < MAX_PATH) {
+        return string(buffer, len);
+    }
+#elif defined(__linux__)
+    error_code ec;
+    auto self = filesystem::read_symlink("/proc/self/exe", ec);
+    if(!ec) {
+        return self.string();
+    }
+#endif
+    return argv0 ? argv0 : "";
+}
+
+/// return a string that changes whenever the file or directory is modified. A single stat() per input: a cache hit
+/// stamps every input, and has to stay cheaper than the query it saves
+string file_stamp(const string& path)
+{
+    FileStamp stamp = get_file_stamp(path);
+    if(!stamp.exists) {
+        return "-";
+    }
+    return to_string(stamp.mtime) + ":" + to_string(stamp.size);
+}
+
+/// an entry file: 16 hex chars. The subdirs (rsp, toolchain...) and the temporary files of running writers are not
+bool is_entry_name(const string& name)
+{
+    return name.length() == 16 && all_of(name.begin(), name.end(), [](char ch) { return isxdigit(ch); });
+}
+
+/// keep the cache dir bounded: every distinct command line, working directory and environment adds an entry
+void prune_entries(const string& dir)
+{
+    vector<pair<filesystem::file_time_type, filesystem::path>> entries;
+    error_code ec;
+    for(filesystem::directory_iterator iter(dir, ec), end; !ec && iter != end; iter.increment(ec)) {
+        if(is_entry_name(iter->path().filename().string())) {
+            auto mtime = iter->last_write_time(ec);
+            if(!ec) {
+                entries.push_back({ mtime, iter->path() });
+            }
+        }
+    }
+    if(entries.size() <= kMaxEntries) {
+        return;
+    }
+    // oldest first. Concurrent writers may prune the same entries: a missing file is not an error
+    sort(entries.begin(), entries.end());
+    size_t excess = entries.size() - kMaxEntries * 3 / 4;
+    for(size_t i = 0; i < excess; ++i) {
+        filesystem::remove(entries[i].second, ec);
+    }
+}
+}
+
+ResultCache::ResultCache(const string& tool_name, int argc, char** argv)
+{
+    if(!safe_getenv("WXCONFIG_NO_CACHE").empty()) {
+        m_enabled = false;
+        return;
+    }
+
+    stringstream ss;
+    ss << kCacheFormat << '\0' << tool_name << '\0';
+    for(int i = 1; i < argc; ++i) {
+        ss << argv[i] << '\0';
+    }
+    for(const char* name : { "WXWIN", "WXCFG", "WXVER" }) {
+        ss << name << "=" << safe_getenv(name) << '\0';
+    }
+    m_key_material = ss.str();
+    m_argv0 = argc > 0 && argv[0] ? argv[0] : "";
+}
+
+string ResultCache::get_key() const
+{
+    // relative prefixes are resolved against the working directory. Looked up here, not when the cache is created: a
+    // query the tool decides not to cache must not pay for it
+    error_code ec;
+    return m_key_material + filesystem::current_path(ec).string() + '\0';
+}
+
+string get_cache_dir()
+{
+    string base = safe_getenv("XDG_CACHE_HOME");
+    if(base.empty()) {
+#ifdef _WIN32
+        base = safe_getenv("LOCALAPPDATA");
+#else
+        base = safe_getenv("HOME");
+        if(!base.empty()) {
+            base += DIR_SEP_STR ".cache";
+        }
+#endif
+    }
+    if(base.empty()) {
+        return "";
+    }
+    return base + DIR_SEP_STR "wx-config";
+}
+
+string ResultCache::get_entry_path(uint64_t key) const
+{
+    string dir = get_cache_dir();
+    if(dir.empty()) {
+        return "";
+    }
+    return dir + DIR_SEP + to_hex(key);
+}
+
+string ResultCache::compute_stamp() const
+{
+    // an upgraded tool must not serve output produced by an older build
+    string stamp = kCacheFormat;
+    stamp += " ";
+    stamp += file_stamp(get_self_path(m_argv0.c_str()));
+    for(const auto& input : m_inputs) {
+        stamp += " ";
+        stamp += file_stamp(input);
+    }
+    return stamp;
+}
+
+bool ResultCache::lookup(string& output) const
+{
+    if(!m_enabled) {
+        return false;
+    }
+
+    // a sibling of this `make -j` job may have published the output already
+    string current_stamp = compute_stamp();
+    uint64_t key = fnv1a_64(get_key());
+    SharedResultTable* table = SharedResultTable::get();
+    if(table && table->lookup(key, fnv1a_64(current_stamp), output)) {
+        return true;
+    }
+
+    string path = get_entry_path(key);
+    if(path.empty()) {
+        return false;
+    }
+
+    ifstream infile(path, ios::binary);
+    if(!infile.good()) {
+        return false;
+    }
+
+    string stamp;
+    if(!getline(infile, stamp) || stamp != current_stamp) {
+        // the install tree (or the tool) changed since this entry was written
+        return false;
+    }
+
+    stringstream content;
+    content << infile.rdbuf();
+    output = content.str();
+    if(table) {
+        table->publish(key, fnv1a_64(current_stamp), output);
+    }
+    return true;
+}
+
+void ResultCache::store(const string& output) const
+{
+    if(!m_enabled) {
+        return;
+    }
+
+    string stamp = compute_stamp();
+    uint64_t key = fnv1a_64(get_key());
+    if(SharedResultTable* table = SharedResultTable::get()) {
+        table->publish(key, fnv1a_64(stamp), output);
+    }
+
+    string path = get_entry_path(key);
+    if(path.empty()) {
+        return;
+    }
+
+    string dir = get_cache_dir();
+    error_code ec;
+    filesystem::create_directories(dir, ec);
+    if(ec) {
+        return;
+    }
+
+    // readers see either the old entry or the new one, never a partial write
+    if(write_file_if_changed(path, stamp + "\n" + output)) {
+        prune_entries(dir);
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef CACHE_HPP
+#define CACHE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/// $XDG_CACHE_HOME/wx-config (~/.cache/wx-config, or %LOCALAPPDATA%\wx-config on Windows). Empty if unknown
+string get_cache_dir();
+
+/**
+ * @brief a persistent, on-disk memo of the tool output
+ *
+ * Each entry is stored in its own file under $XDG_CACHE_HOME/wx-config (or the platform equivalent). The file name is
+ * a hash of the tool name, the command line, the working directory and the WXWIN/WXCFG/WXVER environment variables.
+ * The first line of the file holds a stamp built from the modification time of every input registered with
+ * `add_input()`: if the install tree changes, the stamp no longer matches and the entry is recomputed. Entries are
+ * published with write-to-temp + rename, so concurrent `make -j` jobs never observe a partially written file.
+ *
+ * Outputs are also published to the SharedResultTable, which concurrent invocations check before the file
+ */
+class ResultCache
+{
+    string m_key_material;
+    string m_argv0;
+    vector<string> m_inputs;
+    bool m_enabled = true;
+
+    string get_key() const;
+    string get_entry_path(uint64_t key) const;
+    string compute_stamp() const;
+
+public:
+    ResultCache(const string& tool_name, int argc, char** argv);
+
+    /**
+     * @brief register a file or directory whose modification time invalidates the cached entry
+     */
+    void add_input(const string& path) { m_inputs.push_back(path); }
+
+    /**
+     * @brief make the entry depend on `value` too, for an input that is not on the command line (a discovered prefix)
+     */
+    void add_key(const string& value)
+    {
+        m_key_material += value;
+        m_key_material += '\0';
+    }
+
+    /**
+     * @brief disable the cache for this invocation (e.g. when the run has side effects)
+     */
+    void disable() { m_enabled = false; }
+    bool is_enabled() const { return m_enabled; }
+
+    /**
+     * @brief lookup a cached output. Return true and fill `output` on hit
+     */
+    bool lookup(string& output) const;
+
+    /**
+     * @brief store the output for this invocation. Errors are silently ignored
+     */
+    void store(const string& output) const;
+};
+
+#endif // CACHE_HPP
@@ -0,0 +1,79 @@
+#ifndef FLAG_CATALOG_HPP
+#define FLAG_CATALOG_HPP
+
+#include "lib_catalog.hpp"
+
+#include <string_view>
+
+using namespace std;
+
+/**
+ * @brief the fixed flags and the library naming rules of both tools, evaluated at compile time.
+ *
+ * Shared by the full tools (local_install.cpp, msys2_install.cpp) and the lean ones (wx-config-lean.cpp), so their
+ * outputs can not drift apart. Header only and allocation free: the lean tools do not link the C++ runtime.
+ */
+
+/// the compile flags of every MSW build, after the toolchain specific ones
+inline constexpr string_view kMswCompileFlags[] = { "-D_FILE_OFFSET_BITS=64", "-DWXUSINGDLL", "-D__WXMSW__",
+    "-DHAVE_W32API_H", "-D_UNICODE", "-fmessage-length=0", "-pipe" };
+
+/// the toolchain specific compile flags, for gcc (and MSYS2)
+inline constexpr string_view kGccCompileFlags[] = { "-mthreads" };
+
+/// for clang: wxWidgets generates tons of these warnings
+inline constexpr string_view kClangCompileFlags[] = { "-Wno-ignored-attributes", "-Wno-unknown-pragmas",
+    "-Wno-unused-private-field" };
+
+/// appended for release builds of a local install
+inline constexpr string_view kReleaseCompileFlags[] = { "-DwxDEBUG_LEVEL=0" };
+
+/// the resource compiler defines (--rcflags)
+inline constexpr string_view kRcDefines[] = { "__WXMSW__", "_UNICODE", "WXUSINGDLL" };
+
+/// the link flags, before the libraries
+inline constexpr string_view kLinkFlags[] = { "-pipe" };
+
+/// the MSYS2 include dirs are <prefix><dir><wx_ver>
+inline constexpr string_view kMsys2IncludeDirs[] = { "/lib/wx/include/msw-unicode", "/include/wx" };
+
+/**
+ * @brief call `append(string_view)` with the parts of the MSYS2 link name of the catalog library `index` for the
+ * version `wx_ver` (e.g. kLibCore, "-3.2" -> "wx_mswu", "_", "core", "-3.2")
+ */
+template <typename Append> constexpr void append_msys2_lib_name(int index, string_view wx_ver, Append&& append)
+{
+    append(kWxLibs[index].category == LibCategory::kBase ? "wx_baseu" : "wx_mswu");
+    if(index != kLibBase) {
+        append("_");
+        append(kWxLibs[index].name);
+    }
+    append(wx_ver);
+}
+
+/**
+ * @brief call `append(string_view)` with the parts of the link name of `lib` in a local install of version
+ * <major><minor> (e.g. "core" -> "wxmsw", "3", "2", "u", "_", "core"). A monolithic build has a single library, plus
+ * the opengl support library which is always a separate one. Unknown libraries get the wxmsw prefix
+ */
+template <typename Append>
+constexpr void append_local_lib_name(
+    string_view lib, string_view major, string_view minor, bool debug, bool monolithic, Append&& append)
+{
+    int index = find_wx_lib(lib);
+    bool is_base = !monolithic && index >= 0 && kWxLibs[index].category == LibCategory::kBase;
+    append(is_base ? "wxbase" : "wxmsw");
+    append(major);
+    append(minor);
+    append(debug ? "ud" : "u");
+    if(monolithic) {
+        if(index == kLibGl) {
+            append("_gl");
+        }
+    } else if(index != kLibBase) {
+        append("_");
+        append(lib);
+    }
+}
+
+#endif // FLAG_CATALOG_HPP
@@ -0,0 +1,212 @@
+#include "header_units.hpp"
+
+#include "cache.hpp"
+#include "lib_catalog.hpp"
+#include "mapped_file.hpp"
+#include "utils.hpp"
+
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+namespace
+{
+/// bump this when the header table or the layout of the header-units directory changes
+constexpr const char* kHeaderUnitsFormat = "wx-config-header-units-1";
+
+/// the main header of each library, indexed by WxLib. adv was merged into core, base gets one for console apps only
+constexpr array<string_view, kWxLibCount> kLibHeaders = { {
+    "wx/xrc/xmlres.h",
+    "wx/webview.h",
+    "wx/stc/stc.h",
+    "wx/richtext/richtextctrl.h",
+    "wx/ribbon/bar.h",
+    "wx/propgrid/propgrid.h",
+    "wx/aui/aui.h",
+    "wx/glcanvas.h",
+    "wx/mediactrl.h",
+    "wx/html/htmlwin.h",
+    "wx/debugrpt.h",
+    "",
+    "wx/wx.h",
+    "wx/xml/xml.h",
+    "wx/socket.h",
+    "wx/app.h",
+} };
+
+string stamp_of(const string& path)
+{
+    FileStamp stamp = get_file_stamp(path);
+    if(!stamp.exists) {
+        return "-";
+    }
+    return to_string(stamp.mtime) + ":" + to_string(stamp.size);
+}
+
+bool is_clang(const string& compiler)
+{
+    return filesystem::path(compiler).filename().string().find("clang") != string::npos;
+}
+
+string unique_suffix()
+{
+    random_device rd;
+    return "-" + to_hex((uint64_t(rd()) << 32) | rd());
+}
+
+/**
+ * @brief the dirs the compiler searches, spelled the way it spells them: GCC names a header unit after the path it
+ * found the header at
+ */
+vector<string> search_dirs(const WxFlags& flags)
+{
+    vector<string> result;
+    for(const auto& dir : flags.include_dirs) {
+        string normalized_dir = normalize_path(dir);
+        bool remapped = !flags.include_prefix.empty() && normalized_dir.starts_with(flags.include_prefix + "/");
+        result.push_back(remapped ? normalized_dir : dir);
+    }
+    return result;
+}
+
+/// wx/aui/aui.h -> wx_aui_aui.h
+string bmi_name(const string& header)
+{
+    string name = header;
+    replace(name.begin(), name.end(), '/', '_');
+    return name;
+}
+}
+
+vector<string> get_header_unit_headers(const vector<string>& libs)
+{
+    LibSet set = 0;
+    for(const auto& lib : libs) {
+        if(int index = find_wx_lib(lib); index >= 0) {
+            set |= LibSet(1) << index;
+        }
+    }
+    // wx/wx.h already has everything wx/app.h has
+    if(set & lib_bit(kLibCore)) {
+        set &= ~lib_bit(kLibBase);
+    }
+
+    // a header includes the headers of its dependencies: build those first
+    vector<string> headers;
+    for(size_t i = kWxLibs.size(); i-- > 0;) {
+        if((set & (LibSet(1) << i)) && !kLibHeaders[i].empty()) {
+            headers.emplace_back(kLibHeaders[i]);
+        }
+    }
+    return headers;
+}
+
+string build_header_units(const WxFlags& flags, const vector<string>& libs, const string& compiler)
+{
+    string compiler_path = find_program(compiler);
+    if(compiler_path.empty()) {
+        cerr << "could not find the compiler: " << compiler << endl;
+        fatal_exit(1);
+    }
+    bool clang = is_clang(compiler_path);
+    vector<string> compile_flags = cflags_list(flags);
+    compile_flags.push_back("-std=c++20");
+
+    // header -> the path the compiler finds it at
+    vector<pair<string, string>> headers;
+    for(const auto& header : get_header_unit_headers(libs)) {
+        for(const auto& dir : search_dirs(flags)) {
+            string path = dir + DIR_SEP + header;
+            if(get_file_stamp(path).exists) {
+                headers.push_back({ header, path });
+                break;
+            }
+        }
+    }
+    if(headers.empty()) {
+        cerr << "could not find any wxWidgets header in the include dirs of " << flags.prefix << endl;
+        fatal_exit(1);
+    }
+
+    stringstream key;
+    key << kHeaderUnitsFormat << '\0' << compiler_path << '\0' << stamp_of(compiler_path) << '\0';
+    for(const auto& flag : compile_flags) {
+        key << flag << '\0';
+    }
+    // an upgraded wx install changes these
+    for(const auto& [header, path] : headers) {
+        key << path << '\0' << stamp_of(path) << '\0';
+    }
+    for(const auto& dir : flags.include_dirs) {
+        key << stamp_of(dir + DIR_SEP + "wx/setup.h") << '\0';
+    }
+
+    string cache_dir = get_cache_dir();
+    if(cache_dir.empty()) {
+        cerr << "could not determine the cache directory, please set XDG_CACHE_HOME" << endl;
+        fatal_exit(1);
+    }
+    // a BMI records the path of the BMIs it imports, so they are built where they stay. Concurrent builds each get
+    // their own directory and the first one to finish publishes its flags
+    string units_root = cache_dir + DIR_SEP + "header-units";
+    string result_file = units_root + DIR_SEP + to_hex(fnv1a_64(key.str())) + ".flags";
+    if(MappedFile file; file.open(result_file) && !file.view().empty()) {
+        return string(file.view());
+    }
+
+    string units_dir = units_root + DIR_SEP + to_hex(fnv1a_64(key.str())) + unique_suffix();
+    string mapper = units_dir + DIR_SEP + "wx.mapper";
+    error_code ec;
+    filesystem::create_directories(units_dir, ec);
+
+    vector<string> bmis;
+    stringstream mapper_content;
+    for(const auto& [header, path] : headers) {
+        bmis.push_back(units_dir + DIR_SEP + bmi_name(header) + (clang ? ".pcm" : ".gcm"));
+        mapper_content << path << " " << bmis.back() << "\n";
+    }
+    if(!clang && !write_file_if_changed(mapper, mapper_content.str())) {
+        filesystem::remove_all(units_dir, ec);
+        cerr << "failed to write " << mapper << endl;
+        fatal_exit(1);
+    }
+
+    for(size_t i = 0; i < headers.size(); ++i) {
+        vector<string> command = { compiler_path };
+        command.insert(command.end(), compile_flags.begin(), compile_flags.end());
+        if(clang) {
+            command.insert(command.end(), { "-xc++-user-header", "--precompile", headers[i].second, "-o", bmis[i] });
+        } else {
+            // the mapper tells GCC where the BMI goes, and where to find the ones built before
+            command.insert(
+                command.end(), { "-fmodules-ts", "-fmodule-mapper=" + mapper, "-x", "c++-header", headers[i].second });
+        }
+        if(run_command(command) != 0) {
+            filesystem::remove_all(units_dir, ec);
+            cerr << "failed to build the header unit of: " << headers[i].second << endl;
+            fatal_exit(1);
+        }
+    }
+
+    // another build finished first: keep its BMIs, the ones its consumers use
+    if(MappedFile file; file.open(result_file) && !file.view().empty()) {
+        filesystem::remove_all(units_dir, ec);
+        return string(file.view());
+    }
+
+    string result;
+    if(clang) {
+        result = "-std=c++20";
+        for(const auto& bmi : bmis) {
+            result += " -fmodule-file=" + bmi;
+        }
+    } else {
+        result = "-std=c++20 -fmodules-ts -fmodule-mapper=" + mapper;
+    }
+    if(!write_file_if_changed(result_file, result)) {
+        cerr << "failed to write " << result_file << endl;
+        fatal_exit(1);
+    }
+    return result;
+}
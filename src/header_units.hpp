@@ -0,0 +1,28 @@
+#ifndef HEADER_UNITS_HPP
+#define HEADER_UNITS_HPP
+
+#include "wx_flags.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief the main header of each library of `libs` (expanded lib names): wx/wx.h for core, wx/aui/aui.h for aui...
+ * Dependencies come first. Libraries without a header of their own (adv, base when core is there) are skipped
+ */
+vector<string> get_header_unit_headers(const vector<string>& libs);
+
+/**
+ * @brief build (or reuse) the C++20 header units of the main wx headers of `libs` for `flags` with `compiler`, and
+ * return the flags a consumer adds to its compile line to `import <wx/wx.h>;` (and the others).
+ *
+ * The headers are compiled with the --cflags output and -std=c++20, once per key like the --pch output: the key covers
+ * the compiler (path, mtime and size), every compile flag and the headers. GCC gets a module mapper file
+ * (`-fmodules-ts -fmodule-mapper=<file>`) listing the header -> BMI pairs, clang a `-fmodule-file=<pcm>` per header.
+ * Headers missing from the install are left out
+ */
+string build_header_units(const WxFlags& flags, const vector<string>& libs, const string& compiler);
+
+#endif // HEADER_UNITS_HPP
@@ -0,0 +1,448 @@
+// libwxconfig-iocount: an LD_PRELOAD shim counting the file system calls of a process (Linux only).
+//
+//   LD_PRELOAD=bin/libwxconfig-iocount.so WXCONFIG_IO_REPORT=io.jsonl wx-config-msys2 --prefix=... --cflags
+//
+// Every call of the functions below is forwarded to libc and counted. When the process exits, one JSON line is
+// appended to $WXCONFIG_IO_REPORT (stderr when unset):
+//
+// {"pid":42,"argv":[...],"syscalls":17,"dir_entries":120,"bytes_read":4096,"bytes_written":80,"calls":{"open":3,...}}
+//
+// "syscalls" sums the calls that map to a single system call. readdir() is reported as "dir_entries" instead, one per
+// entry returned: libc reads the entries in batches. With WXCONFIG_IO_BUDGET=<syscalls>, a process that made more
+// system calls than that reports it on stderr and exits with code 98, so a script or the bench can catch I/O
+// regressions.
+//
+// Calls libc makes internally (e.g. the openat() behind opendir()) are not visible, only the ones made by the tool and
+// by libstdc++ (std::filesystem, std::fstream).
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+enum Call {
+    kOpen,
+    kFopen,
+    kStat,
+    kAccess,
+    kReadlink,
+    kOpendir,
+    kClosedir,
+    kReaddir,
+    kRead,
+    kWrite,
+    kClose,
+    kMmap,
+    kRename,
+    kUnlink,
+    kMkdir,
+    kGetcwd,
+    kConnect,
+    kCallCount,
+};
+
+constexpr const char* kCallNames[kCallCount] = { "open", "fopen", "stat", "access", "readlink", "opendir", "closedir",
+    "readdir", "read", "write", "close", "mmap", "rename", "unlink", "mkdir", "getcwd", "connect" };
+
+std::atomic<unsigned long long> calls[kCallCount];
+std::atomic<unsigned long long> bytes_read;
+std::atomic<unsigned long long> bytes_written;
+// the report itself is not counted
+thread_local bool reporting = false;
+
+void count(Call call)
+{
+    if(!reporting) {
+        ++calls[call];
+    }
+}
+
+/// the libc implementation of `name`
+template <typename Func> Func next(const char* name)
+{
+    return reinterpret_cast<Func>(::dlsym(RTLD_NEXT, name));
+}
+
+#define FORWARD(name, type) static auto real = next<type>(#name)
+
+unsigned long long syscall_count()
+{
+    unsigned long long total = 0;
+    for(int i = 0; i < kCallCount; ++i) {
+        if(i != kReaddir) {
+            total += calls[i];
+        }
+    }
+    return total;
+}
+
+/// the report line, assembled without allocating: the process is exiting
+class Line
+{
+    char m_data[16384];
+    size_t m_length = 0;
+
+public:
+    void append(const char* format, ...) __attribute__((format(printf, 2, 3)))
+    {
+        va_list args;
+        va_start(args, format);
+        int count = vsnprintf(m_data + m_length, sizeof(m_data) - m_length, format, args);
+        va_end(args);
+        if(count > 0) {
+            m_length = m_length + count < sizeof(m_data) ? m_length + count : sizeof(m_data) - 1;
+        }
+    }
+
+    void append_json_string(const char* str)
+    {
+        append("\"");
+        for(; *str; ++str) {
+            unsigned char ch = static_cast<unsigned char>(*str);
+            if(ch == '"' || ch == '\\') {
+                append("\\%c", ch);
+            } else if(ch < 0x20) {
+                append("\\u%04x", ch);
+            } else {
+                append("%c", ch);
+            }
+        }
+        append("\"");
+    }
+
+    const char* data() const { return m_data; }
+    size_t length() const { return m_length; }
+};
+
+void write_fully(int fd, const char* data, size_t length)
+{
+    while(length > 0) {
+        ssize_t written = ::write(fd, data, length);
+        if(written <= 0) {
+            return;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+    }
+}
+
+__attribute__((destructor)) void report()
+{
+    reporting = true;
+    static Line line;
+    line.append("{\"pid\":%d,\"argv\":[", static_cast<int>(::getpid()));
+
+    // /proc/self/cmdline: the arguments, each one followed by a NUL
+    static char cmdline[8192];
+    int fd = ::open("/proc/self/cmdline", O_RDONLY | O_CLOEXEC);
+    ssize_t cmdline_length = fd < 0 ? 0 : ::read(fd, cmdline, sizeof(cmdline) - 1);
+    if(fd >= 0) {
+        ::close(fd);
+    }
+    cmdline[cmdline_length > 0 ? cmdline_length : 0] = 0;
+    for(ssize_t pos = 0; pos < cmdline_length; pos += strlen(cmdline + pos) + 1) {
+        line.append(pos == 0 ? "" : ",");
+        line.append_json_string(cmdline + pos);
+    }
+
+    line.append("],\"syscalls\":%llu,\"dir_entries\":%llu,\"bytes_read\":%llu,\"bytes_written\":%llu,\"calls\":{",
+        syscall_count(), calls[kReaddir].load(), bytes_read.load(), bytes_written.load());
+    for(int i = 0; i < kCallCount; ++i) {
+        line.append("%s\"%s\":%llu", i == 0 ? "" : ",", kCallNames[i], calls[i].load());
+    }
+    line.append("}}\n");
+
+    const char* path = ::getenv("WXCONFIG_IO_REPORT");
+    int out = path && *path ? ::open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644) : 2;
+    if(out >= 0) {
+        // a single write, so the lines of concurrent processes do not interleave
+        write_fully(out, line.data(), line.length());
+        if(out != 2) {
+            ::close(out);
+        }
+    }
+
+    const char* budget = ::getenv("WXCONFIG_IO_BUDGET");
+    if(budget && *budget && syscall_count() > strtoull(budget, nullptr, 10)) {
+        Line message;
+        message.append("wx-config: %llu system calls, over the budget of %s\n", syscall_count(), budget);
+        write_fully(2, message.data(), message.length());
+        ::_exit(98);
+    }
+}
+}
+
+extern "C" {
+
+#define DEFINE_OPEN(name)                                                                                              \
+    int name(const char* path, int flags, ...)                                                                         \
+    {                                                                                                                  \
+        FORWARD(name, int (*)(const char*, int, ...));                                                                 \
+        count(kOpen);                                                                                                  \
+        mode_t mode = 0;                                                                                               \
+        if(flags & (O_CREAT | O_TMPFILE)) {                                                                            \
+            va_list args;                                                                                              \
+            va_start(args, flags);                                                                                     \
+            mode = va_arg(args, mode_t);                                                                               \
+            va_end(args);                                                                                              \
+        }                                                                                                              \
+        return real(path, flags, mode);                                                                                \
+    }
+DEFINE_OPEN(open)
+DEFINE_OPEN(open64)
+
+#define DEFINE_OPENAT(name)                                                                                            \
+    int name(int dirfd, const char* path, int flags, ...)                                                              \
+    {                                                                                                                  \
+        FORWARD(name, int (*)(int, const char*, int, ...));                                                            \
+        count(kOpen);                                                                                                  \
+        mode_t mode = 0;                                                                                               \
+        if(flags & (O_CREAT | O_TMPFILE)) {                                                                            \
+            va_list args;                                                                                              \
+            va_start(args, flags);                                                                                     \
+            mode = va_arg(args, mode_t);                                                                               \
+            va_end(args);                                                                                              \
+        }                                                                                                              \
+        return real(dirfd, path, flags, mode);                                                                         \
+    }
+DEFINE_OPENAT(openat)
+DEFINE_OPENAT(openat64)
+
+FILE* fopen(const char* path, const char* mode)
+{
+    FORWARD(fopen, FILE* (*)(const char*, const char*));
+    count(kFopen);
+    return real(path, mode);
+}
+
+FILE* fopen64(const char* path, const char* mode)
+{
+    FORWARD(fopen64, FILE* (*)(const char*, const char*));
+    count(kFopen);
+    return real(path, mode);
+}
+
+// stat() and friends are functions since glibc 2.33, __xstat() and friends before
+#define DEFINE_STAT(name, type)                                                                                        \
+    int name(const char* path, struct type* buf)                                                                       \
+    {                                                                                                                  \
+        FORWARD(name, int (*)(const char*, struct type*));                                                             \
+        count(kStat);                                                                                                  \
+        return real(path, buf);                                                                                        \
+    }
+DEFINE_STAT(stat, stat)
+DEFINE_STAT(stat64, stat64)
+DEFINE_STAT(lstat, stat)
+DEFINE_STAT(lstat64, stat64)
+
+int fstat(int fd, struct stat* buf)
+{
+    FORWARD(fstat, int (*)(int, struct stat*));
+    count(kStat);
+    return real(fd, buf);
+}
+
+int fstat64(int fd, struct stat64* buf)
+{
+    FORWARD(fstat64, int (*)(int, struct stat64*));
+    count(kStat);
+    return real(fd, buf);
+}
+
+int fstatat(int dirfd, const char* path, struct stat* buf, int flags)
+{
+    FORWARD(fstatat, int (*)(int, const char*, struct stat*, int));
+    count(kStat);
+    return real(dirfd, path, buf, flags);
+}
+
+int fstatat64(int dirfd, const char* path, struct stat64* buf, int flags)
+{
+    FORWARD(fstatat64, int (*)(int, const char*, struct stat64*, int));
+    count(kStat);
+    return real(dirfd, path, buf, flags);
+}
+
+int statx(int dirfd, const char* path, int flags, unsigned int mask, struct statx* buf)
+{
+    FORWARD(statx, int (*)(int, const char*, int, unsigned int, struct statx*));
+    count(kStat);
+    return real(dirfd, path, flags, mask, buf);
+}
+
+#define DEFINE_XSTAT(name, type)                                                                                       \
+    int name(int version, const char* path, struct type* buf)                                                          \
+    {                                                                                                                  \
+        FORWARD(name, int (*)(int, const char*, struct type*));                                                        \
+        count(kStat);                                                                                                  \
+        return real(version, path, buf);                                                                               \
+    }
+DEFINE_XSTAT(__xstat, stat)
+DEFINE_XSTAT(__xstat64, stat64)
+DEFINE_XSTAT(__lxstat, stat)
+DEFINE_XSTAT(__lxstat64, stat64)
+
+int access(const char* path, int mode)
+{
+    FORWARD(access, int (*)(const char*, int));
+    count(kAccess);
+    return real(path, mode);
+}
+
+int faccessat(int dirfd, const char* path, int mode, int flags)
+{
+    FORWARD(faccessat, int (*)(int, const char*, int, int));
+    count(kAccess);
+    return real(dirfd, path, mode, flags);
+}
+
+ssize_t readlink(const char* path, char* buf, size_t size)
+{
+    FORWARD(readlink, ssize_t(*)(const char*, char*, size_t));
+    count(kReadlink);
+    return real(path, buf, size);
+}
+
+DIR* opendir(const char* path)
+{
+    FORWARD(opendir, DIR* (*)(const char*));
+    count(kOpendir);
+    return real(path);
+}
+
+DIR* fdopendir(int fd)
+{
+    FORWARD(fdopendir, DIR* (*)(int));
+    count(kOpendir);
+    return real(fd);
+}
+
+int closedir(DIR* dir)
+{
+    FORWARD(closedir, int (*)(DIR*));
+    count(kClosedir);
+    return real(dir);
+}
+
+struct dirent* readdir(DIR* dir)
+{
+    FORWARD(readdir, struct dirent* (*)(DIR*));
+    struct dirent* entry = real(dir);
+    if(entry) {
+        count(kReaddir);
+    }
+    return entry;
+}
+
+struct dirent64* readdir64(DIR* dir)
+{
+    FORWARD(readdir64, struct dirent64* (*)(DIR*));
+    struct dirent64* entry = real(dir);
+    if(entry) {
+        count(kReaddir);
+    }
+    return entry;
+}
+
+ssize_t read(int fd, void* buf, size_t size)
+{
+    FORWARD(read, ssize_t(*)(int, void*, size_t));
+    count(kRead);
+    ssize_t result = real(fd, buf, size);
+    if(result > 0 && !reporting) {
+        bytes_read += result;
+    }
+    return result;
+}
+
+ssize_t pread(int fd, void* buf, size_t size, off_t offset)
+{
+    FORWARD(pread, ssize_t(*)(int, void*, size_t, off_t));
+    count(kRead);
+    ssize_t result = real(fd, buf, size, offset);
+    if(result > 0 && !reporting) {
+        bytes_read += result;
+    }
+    return result;
+}
+
+ssize_t write(int fd, const void* buf, size_t size)
+{
+    FORWARD(write, ssize_t(*)(int, const void*, size_t));
+    count(kWrite);
+    ssize_t result = real(fd, buf, size);
+    if(result > 0 && !reporting) {
+        bytes_written += result;
+    }
+    return result;
+}
+
+int close(int fd)
+{
+    FORWARD(close, int (*)(int));
+    count(kClose);
+    return real(fd);
+}
+
+void* mmap(void* addr, size_t length, int prot, int flags, int fd, off_t offset)
+{
+    FORWARD(mmap, void* (*)(void*, size_t, int, int, int, off_t));
+    // anonymous mappings are the allocator's, not I/O
+    if(fd >= 0) {
+        count(kMmap);
+        if(!reporting) {
+            bytes_read += length;
+        }
+    }
+    return real(addr, length, prot, flags, fd, offset);
+}
+
+int rename(const char* from, const char* to)
+{
+    FORWARD(rename, int (*)(const char*, const char*));
+    count(kRename);
+    return real(from, to);
+}
+
+int unlink(const char* path)
+{
+    FORWARD(unlink, int (*)(const char*));
+    count(kUnlink);
+    return real(path);
+}
+
+int mkdir(const char* path, mode_t mode)
+{
+    FORWARD(mkdir, int (*)(const char*, mode_t));
+    count(kMkdir);
+    return real(path, mode);
+}
+
+char* getcwd(char* buf, size_t size)
+{
+    FORWARD(getcwd, char* (*)(char*, size_t));
+    count(kGetcwd);
+    return real(buf, size);
+}
+
+int connect(int fd, const struct sockaddr* addr, socklen_t length)
+{
+    FORWARD(connect, int (*)(int, const struct sockaddr*, socklen_t));
+    count(kConnect);
+    return real(fd, addr, length);
+}
+}
@@ -0,0 +1,178 @@
+#ifndef LIB_CATALOG_HPP
+#define LIB_CATALOG_HPP
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+using namespace std;
+
+/**
+ * @brief the wx libraries known to both tools, with their dependencies, evaluated at compile time.
+ *
+ * The catalog is in link order: a library comes before every library it depends on. A set of libraries is a bit mask
+ * over the catalog indexes, so closing a set over its dependencies and walking it in link order allocate nothing.
+ */
+
+/// the index of each library in kWxLibs
+enum WxLib : uint8_t {
+    kLibXrc,
+    kLibWebview,
+    kLibStc,
+    kLibRichtext,
+    kLibRibbon,
+    kLibPropgrid,
+    kLibAui,
+    kLibGl,
+    kLibMedia,
+    kLibHtml,
+    kLibQa,
+    kLibAdv,
+    kLibCore,
+    kLibXml,
+    kLibNet,
+    kLibBase,
+    kWxLibCount,
+};
+
+/// a set of WxLib, bit i is kWxLibs[i]
+using LibSet = uint32_t;
+
+constexpr LibSet lib_bit(WxLib lib) { return LibSet(1) << lib; }
+
+/// base libraries are named wxbase* (wx_baseu* for MSYS2), the GUI ones wxmsw* (wx_mswu*)
+enum class LibCategory { kBase, kMsw };
+
+struct WxLibInfo {
+    string_view name;
+    LibCategory category;
+    LibSet deps; // the libraries it links against directly
+};
+
+inline constexpr array<WxLibInfo, kWxLibCount> kWxLibs = { {
+    { "xrc", LibCategory::kMsw, lib_bit(kLibHtml) | lib_bit(kLibXml) | lib_bit(kLibCore) | lib_bit(kLibBase) },
+    { "webview", LibCategory::kMsw, lib_bit(kLibCore) | lib_bit(kLibBase) },
+    { "stc", LibCategory::kMsw, lib_bit(kLibCore) | lib_bit(kLibBase) },
+    { "richtext", LibCategory::kMsw, lib_bit(kLibHtml) | lib_bit(kLibXml) | lib_bit(kLibCore) | lib_bit(kLibBase) },
+    { "ribbon", LibCategory::kMsw, lib_bit(kLibCore) | lib_bit(kLibBase) },
+    { "propgrid", LibCategory::kMsw, lib_bit(kLibCore) | lib_bit(kLibBase) },
+    { "aui", LibCategory::kMsw, lib_bit(kLibCore) | lib_bit(kLibBase) },
+    { "gl", LibCategory::kMsw, lib_bit(kLibCore) | lib_bit(kLibBase) },
+    { "media", LibCategory::kMsw, lib_bit(kLibCore) | lib_bit(kLibBase) },
+    { "html", LibCategory::kMsw, lib_bit(kLibCore) | lib_bit(kLibBase) },
+    { "qa", LibCategory::kMsw, lib_bit(kLibXml) | lib_bit(kLibCore) | lib_bit(kLibBase) },
+    { "adv", LibCategory::kMsw, lib_bit(kLibCore) | lib_bit(kLibBase) },
+    { "core", LibCategory::kMsw, lib_bit(kLibBase) },
+    { "xml", LibCategory::kBase, lib_bit(kLibBase) },
+    { "net", LibCategory::kBase, lib_bit(kLibBase) },
+    { "base", LibCategory::kBase, 0 },
+} };
+
+inline constexpr LibSet kAllLibs = (LibSet(1) << kWxLibCount) - 1;
+/// --libs std
+inline constexpr LibSet kStdLibs = lib_bit(kLibXrc) | lib_bit(kLibWebview) | lib_bit(kLibHtml) | lib_bit(kLibQa)
+                                   | lib_bit(kLibAdv) | lib_bit(kLibCore) | lib_bit(kLibXml) | lib_bit(kLibNet)
+                                   | lib_bit(kLibBase);
+
+namespace lib_catalog_detail
+{
+constexpr bool is_link_ordered()
+{
+    for(size_t i = 0; i < kWxLibs.size(); ++i) {
+        if(kWxLibs[i].deps & ((LibSet(2) << i) - 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(is_link_ordered(), "a library must come before the libraries it depends on");
+
+/// FNV-1a 32, seeded so the catalog names land in distinct slots
+constexpr uint32_t name_hash(string_view name, uint32_t seed)
+{
+    uint32_t hash = 2166136261u ^ seed;
+    for(char ch : name) {
+        hash = (hash ^ static_cast<unsigned char>(ch)) * 16777619u;
+    }
+    return hash;
+}
+
+constexpr size_t kSlotBits = 5;
+constexpr size_t kSlotCount = size_t(1) << kSlotBits; // at least kWxLibCount
+
+/// the top bits: the low bits of an FNV hash only depend on the low bits of its input
+constexpr size_t slot_of(string_view name, uint32_t seed) { return name_hash(name, seed) >> (32 - kSlotBits); }
+
+constexpr bool is_perfect(uint32_t seed)
+{
+    array<bool, kSlotCount> used {};
+    for(const auto& lib : kWxLibs) {
+        size_t slot = slot_of(lib.name, seed);
+        if(used[slot]) {
+            return false;
+        }
+        used[slot] = true;
+    }
+    return true;
+}
+
+constexpr uint32_t find_seed()
+{
+    for(uint32_t seed = 0; seed < 100000; ++seed) {
+        if(is_perfect(seed)) {
+            return seed;
+        }
+    }
+    return UINT32_MAX;
+}
+
+inline constexpr uint32_t kSeed = find_seed();
+static_assert(kSeed != UINT32_MAX, "no perfect hash seed for the library names");
+
+constexpr array<int8_t, kSlotCount> make_slots()
+{
+    array<int8_t, kSlotCount> slots {};
+    for(auto& slot : slots) {
+        slot = -1;
+    }
+    for(size_t i = 0; i < kWxLibs.size(); ++i) {
+        slots[slot_of(kWxLibs[i].name, kSeed)] = static_cast<int8_t>(i);
+    }
+    return slots;
+}
+
+inline constexpr array<int8_t, kSlotCount> kSlots = make_slots();
+}
+
+/// the catalog index of the library called `name` ("core"), or -1
+constexpr int find_wx_lib(string_view name)
+{
+    int index = lib_catalog_detail::kSlots[lib_catalog_detail::slot_of(name, lib_catalog_detail::kSeed)];
+    return index >= 0 && kWxLibs[index].name == name ? index : -1;
+}
+static_assert(find_wx_lib("aui") == kLibAui && find_wx_lib("base") == kLibBase && find_wx_lib("nope") == -1);
+
+/// `libs` plus everything they depend on, directly or not
+constexpr LibSet close_lib_set(LibSet libs)
+{
+    // link order: the dependencies of a library come after it, a single pass sees them all
+    for(size_t i = 0; i < kWxLibs.size(); ++i) {
+        if(libs & (LibSet(1) << i)) {
+            libs |= kWxLibs[i].deps;
+        }
+    }
+    return libs;
+}
+static_assert(close_lib_set(lib_bit(kLibAui)) == (lib_bit(kLibAui) | lib_bit(kLibCore) | lib_bit(kLibBase)));
+
+/// call `func(const WxLibInfo&)` for every library of `libs`, in link order
+template <typename Func> constexpr void for_each_lib(LibSet libs, Func&& func)
+{
+    for(size_t i = 0; i < kWxLibs.size(); ++i) {
+        if(libs & (LibSet(1) << i)) {
+            func(kWxLibs[i]);
+        }
+    }
+}
+
+#endif // LIB_CATALOG_HPP
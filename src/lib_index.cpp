@@ -0,0 +1,127 @@
+#include "lib_index.hpp"
+
+#include "mapped_file.hpp"
+#include "utils.hpp"
+
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <string_view>
+
+namespace
+{
+struct CachedIndex {
+    FileStamp stamp;
+    shared_ptr<const LibIndex> index;
+};
+
+/// lib dir -> its index. Adding or removing a file changes the mtime of the directory, which drops the entry
+unordered_map<string, CachedIndex> lib_indexes;
+mutex lib_indexes_mutex;
+}
+
+bool LibIndex::scan(const string& dir)
+{
+    m_entries.clear();
+    error_code ec;
+    filesystem::directory_iterator iter(dir, ec);
+    if(ec) {
+        return false;
+    }
+
+    for(; iter != filesystem::directory_iterator(); iter.increment(ec)) {
+        if(ec) {
+            return false;
+        }
+        string file_name = iter->path().filename().string();
+        string_view name = file_name;
+        if(name.starts_with("lib") && name.ends_with(".dll.a")) {
+            name = name.substr(3, name.length() - 9);
+            m_entries[string(name)].import_lib = dir + DIR_SEP + file_name;
+        } else if(name.starts_with("lib") && name.ends_with(".a")) {
+            name = name.substr(3, name.length() - 5);
+            m_entries[string(name)].static_lib = dir + DIR_SEP + file_name;
+        } else if(name.ends_with(".lib")) {
+            name = name.substr(0, name.length() - 4);
+            m_entries[string(name)].msvc_lib = dir + DIR_SEP + file_name;
+        }
+    }
+    return true;
+}
+
+string LibIndex::find(const string& name, LibPolicy policy) const
+{
+    auto iter = m_entries.find(name);
+    if(iter == m_entries.end()) {
+        return "";
+    }
+    const Entry& entry = iter->second;
+    const string& first = policy == LibPolicy::kPreferStatic ? entry.static_lib : entry.import_lib;
+    const string& second = policy == LibPolicy::kPreferStatic ? entry.import_lib : entry.static_lib;
+    return !first.empty() ? first : !second.empty() ? second : entry.msvc_lib;
+}
+
+shared_ptr<const LibIndex> get_lib_index(const string& dir)
+{
+    FileStamp stamp = get_file_stamp(dir);
+    {
+        lock_guard lock(lib_indexes_mutex);
+        auto iter = lib_indexes.find(dir);
+        if(iter != lib_indexes.end() && iter->second.stamp == stamp) {
+            return iter->second.index;
+        }
+    }
+
+    // scan outside of the lock, a concurrent scan of the same dir only costs time
+    auto index = make_shared<LibIndex>();
+    index->scan(dir);
+    lock_guard lock(lib_indexes_mutex);
+    lib_indexes[dir] = { stamp, index };
+    return index;
+}
+
+void reset_lib_index_state()
+{
+    lock_guard lock(lib_indexes_mutex);
+    lib_indexes.clear();
+}
+
+vector<string> find_lib_files(WxFlags& flags, LibPolicy policy)
+{
+    vector<shared_ptr<const LibIndex>> indexes;
+    for(const auto& dir : flags.lib_dirs) {
+        indexes.push_back(get_lib_index(dir));
+    }
+
+    vector<string> missing;
+    flags.lib_files.clear();
+    for(const auto& lib : flags.libs) {
+        string path;
+        for(size_t i = 0; i < indexes.size() && path.empty(); ++i) {
+            path = indexes[i]->find(lib, policy);
+        }
+        if(path.empty()) {
+            missing.push_back(lib);
+        } else {
+            flags.lib_files.push_back(path);
+        }
+    }
+    return missing;
+}
+
+void resolve_lib_files(WxFlags& flags, LibPolicy policy)
+{
+    vector<string> missing = find_lib_files(flags, policy);
+    if(!missing.empty()) {
+        cerr << "could not find the following libraries in";
+        for(const auto& dir : flags.lib_dirs) {
+            cerr << " " << dir;
+        }
+        cerr << ":";
+        for(const auto& lib : missing) {
+            cerr << " " << lib;
+        }
+        cerr << endl;
+        fatal_exit(1);
+    }
+}
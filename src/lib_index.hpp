@@ -0,0 +1,60 @@
+#ifndef LIB_INDEX_HPP
+#define LIB_INDEX_HPP
+
+#include "wx_flags.hpp"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/// which file to link when a library is installed both as an import library and as a static archive
+enum class LibPolicy {
+    kPreferImport, // lib<name>.dll.a, then lib<name>.a
+    kPreferStatic, // lib<name>.a, then lib<name>.dll.a
+};
+
+/**
+ * @brief the link libraries of a directory (`lib<name>.dll.a`, `lib<name>.a` and `<name>.lib`), collected with a single
+ * scan of the directory
+ */
+class LibIndex
+{
+    struct Entry {
+        string import_lib;  // lib<name>.dll.a
+        string static_lib;  // lib<name>.a
+        string msvc_lib;    // <name>.lib
+    };
+    unordered_map<string, Entry> m_entries;
+
+public:
+    /// index the content of `dir`. Return false if it can not be read
+    bool scan(const string& dir);
+
+    /// the full path of the library linked as `-l<name>`, empty if it is not installed
+    string find(const string& name, LibPolicy policy = LibPolicy::kPreferImport) const;
+
+    size_t size() const { return m_entries.size(); }
+};
+
+/**
+ * @brief the index of `dir`. It is kept for the lifetime of the process and rebuilt when the directory changes. Safe to
+ * call from several threads
+ */
+shared_ptr<const LibIndex> get_lib_index(const string& dir);
+
+/// forget the directory indexes built so far
+void reset_lib_index_state();
+
+/**
+ * @brief fill `flags.lib_files` with the full path of each library, looked up in the `-L` dirs in order, so the link
+ * line needs neither `-L` nor `-l`. Return the libraries that are not installed
+ */
+vector<string> find_lib_files(WxFlags& flags, LibPolicy policy);
+
+/// --absolute: find_lib_files(), reporting every missing library at once and exiting if there are any
+void resolve_lib_files(WxFlags& flags, LibPolicy policy);
+
+#endif // LIB_INDEX_HPP
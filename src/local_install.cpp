@@ -0,0 +1,186 @@
+#include "local_install.hpp"
+
+#include "flag_catalog.hpp"
+#include "lib_catalog.hpp"
+#include "server.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+BuildCfg build_cfg;
+/// build.cfg path -> parsed content. Kept for the lifetime of the process (relevant for --server)
+unordered_map<string, BuildCfg> parsed_build_cfgs;
+}
+
+void reset_local_state()
+{
+    build_cfg.clear();
+    parsed_build_cfgs.clear();
+}
+
+bool is_monolithic(const BuildCfg& cfg) { return cfg.get("MONOLITHIC") == "1"; }
+
+const BuildCfg& get_build_cfg() { return build_cfg; }
+
+string get_build_cfg_path(const string& install_dir, const string& config)
+{
+    return install_dir + DIR_SEP + "lib" + DIR_SEP + config + DIR_SEP + "build.cfg";
+}
+
+string build_cfg_error(BuildCfg::eLoadResult status, const string& path)
+{
+    switch(status) {
+    case BuildCfg::kLoadNotFound:
+        return "could not open configuration file: " + path;
+    case BuildCfg::kLoadMissingKeys:
+        // not all the required keys were found
+        return "failed to parse build.cfg file: " + path;
+    case BuildCfg::kLoadOk:
+        break;
+    }
+    return "";
+}
+
+void parse_build_cfg(const string& install_dir, const string& config)
+{
+    string path = get_build_cfg_path(install_dir, config);
+    auto iter = parsed_build_cfgs.find(path);
+    if(iter != parsed_build_cfgs.end()) {
+        build_cfg = iter->second;
+        return;
+    }
+
+    BuildCfg::eLoadResult status = build_cfg.load(path);
+    if(status != BuildCfg::kLoadOk) {
+        cerr << build_cfg_error(status, path) << endl;
+        fatal_exit(1);
+    }
+
+    server_watch(path);
+    parsed_build_cfgs.insert({ path, build_cfg });
+}
+
+string get_local_lib_name(const BuildCfg& cfg, const string& lib)
+{
+    // for non monolithic libs, the release lib name could be: wxmsw32u_base or wxmsw32u_xml
+    // the debug lib name could be: wxmsw32ud_base or wxmsw32ud_xml
+    string name;
+    append_local_lib_name(lib, cfg.get("WXVER_MAJOR"), cfg.get("WXVER_MINOR"), cfg.get("BUILD") == "debug",
+        is_monolithic(cfg), [&](string_view part) { name += part; });
+    return name;
+}
+
+/// Add include path to the output
+void add_include_dir(WxFlags& flags, const string& path) { flags.include_dirs.push_back(path); }
+
+/// Add compiler definition to the output (can be -D or some other flag like -fPIC)
+void add_macros(const BuildCfg& cfg, WxFlags& flags)
+{
+    vector<string>& macros = flags.compile_flags;
+    if(cfg.get("COMPILER") != "clang") {
+        macros.insert(macros.end(), begin(kGccCompileFlags), end(kGccCompileFlags));
+    } else {
+        macros.insert(macros.end(), begin(kClangCompileFlags), end(kClangCompileFlags));
+    }
+    macros.insert(macros.end(), begin(kMswCompileFlags), end(kMswCompileFlags));
+
+    if(cfg.get("BUILD") == "release") {
+        macros.insert(macros.end(), begin(kReleaseCompileFlags), end(kReleaseCompileFlags));
+    }
+}
+
+/// Build the libs list
+void add_libs(
+    const BuildCfg& cfg, const vector<string>& libs, const string& config, const string& prefix, WxFlags& flags)
+{
+    // linker flags
+    flags.lib_dirs.push_back(prefix + DIR_SEP + "lib" + DIR_SEP + before_first(config, DIR_SEP_STR));
+    flags.link_flags.insert(flags.link_flags.end(), begin(kLinkFlags), end(kLinkFlags));
+
+    if(is_monolithic(cfg)) {
+        // monolithic lib, example: libwxmsw31u.a or libwxmsw31ud.a
+        flags.libs.push_back(get_local_lib_name(cfg, "base"));
+        // in the monolithic mode, there are usually two lib files, the common is libwxmsw32u.a, the other file is libwxmsw32u_gl.a
+        // this means the wx's opengl support library is always a seperate library, so check to see whether the "gl" option is added
+        // finally, we got the linker option line such as: "-lwxmsw32u -lwxmsw32u_gl"
+        if(find(libs.begin(), libs.end(), "gl") != libs.end()) {
+            flags.libs.push_back(get_local_lib_name(cfg, "gl"));
+        }
+    } else {
+        // translate lib name to file name
+        for(const auto& lib : libs) {
+            flags.libs.push_back(get_local_lib_name(cfg, lib));
+        }
+    }
+}
+
+/// Resolve all the flags from the parsed build.cfg
+WxFlags resolve_local_flags(
+    const BuildCfg& cfg, const vector<string>& libs, const string& prefix, const string& config)
+{
+    WxFlags flags;
+    flags.tool = "wx-config";
+    flags.prefix = prefix;
+    flags.config = config;
+    flags.version = string(cfg.get("WXVER_MAJOR")) + "." + string(cfg.get("WXVER_MINOR"));
+    flags.compiler = string(cfg.get("COMPILER"));
+    flags.build = string(cfg.get("BUILD"));
+    flags.monolithic = is_monolithic(cfg);
+    flags.debug = flags.build == "debug";
+    flags.shared = cfg.get("SHARED") == "1";
+
+    add_include_dir(flags, prefix + DIR_SEP + "lib" + DIR_SEP + config);
+    add_include_dir(flags, prefix + DIR_SEP + "include");
+    add_macros(cfg, flags);
+    flags.extra_cxxflags = string(cfg.get("CXXFLAGS"));
+    flags.rc_defines.assign(begin(kRcDefines), end(kRcDefines));
+    add_libs(cfg, libs, config, prefix, flags);
+    return flags;
+}
+
+vector<string> find_local_configs(const string& prefix)
+{
+    // <prefix>/lib/<compiler dir>/<config dir>/build.cfg
+    vector<string> configs;
+    error_code ec;
+    for(const auto& compiler_dir : filesystem::directory_iterator(prefix + DIR_SEP + "lib", ec)) {
+        if(!compiler_dir.is_directory(ec)) {
+            continue;
+        }
+        for(const auto& config_dir : filesystem::directory_iterator(compiler_dir.path(), ec)) {
+            if(filesystem::is_regular_file(config_dir.path() / "build.cfg", ec)) {
+                configs.push_back(
+                    compiler_dir.path().filename().string() + DIR_SEP + config_dir.path().filename().string());
+            }
+        }
+    }
+    sort(configs.begin(), configs.end());
+    return configs;
+}
+
+vector<LocalConfigFlags> resolve_all_local_flags(
+    const vector<string>& libs, const string& prefix, const vector<string>& configs)
+{
+    vector<LocalConfigFlags> results(configs.size());
+    parallel_for(configs.size(), [&](size_t i) {
+        LocalConfigFlags& result = results[i];
+        result.config = configs[i];
+
+        string path = get_build_cfg_path(prefix, configs[i]);
+        BuildCfg cfg;
+        BuildCfg::eLoadResult status = cfg.load(path);
+        if(status != BuildCfg::kLoadOk) {
+            result.error = build_cfg_error(status, path);
+            return;
+        }
+        result.flags = resolve_local_flags(cfg, libs, prefix, configs[i]);
+    });
+    return results;
+}
@@ -0,0 +1,68 @@
+#ifndef LOCAL_INSTALL_HPP
+#define LOCAL_INSTALL_HPP
+
+#include "build_cfg.hpp"
+#include "utils.hpp"
+#include "wx_flags.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/// <install_dir>/lib/<config>/build.cfg
+string get_build_cfg_path(const string& install_dir, const string& config);
+
+/// the message reported when BuildCfg::load() fails with `status`
+string build_cfg_error(BuildCfg::eLoadResult status, const string& path);
+
+/**
+ * @brief parse <install_dir>/lib/<config>/build.cfg of a locally built wxWidgets. The parsed content is remembered per
+ * file until reset_local_state() is called
+ */
+void parse_build_cfg(const string& install_dir, const string& config);
+
+/// the content of the last parsed build.cfg
+const BuildCfg& get_build_cfg();
+
+/// are we using monolithic build of wxWidgets?
+bool is_monolithic(const BuildCfg& cfg);
+
+/// the link name of `lib` for `cfg` (e.g. "core" -> "wxmsw32u_core", or "wxmsw32u" for monolithic builds)
+string get_local_lib_name(const BuildCfg& cfg, const string& lib);
+
+/// add include path to the output
+void add_include_dir(WxFlags& flags, const string& path);
+
+/// add compiler definitions to the output (can be -D or some other flag like -fPIC)
+void add_macros(const BuildCfg& cfg, WxFlags& flags);
+
+/// build the link flags for the wx `libs` (e.g. "core", see expand_libs())
+void add_libs(
+    const BuildCfg& cfg, const vector<string>& libs, const string& config, const string& prefix, WxFlags& flags);
+
+/// resolve all the flags from the parsed `cfg`
+WxFlags resolve_local_flags(
+    const BuildCfg& cfg, const vector<string>& libs, const string& prefix, const string& config);
+
+/// every config under <prefix>/lib that has a build.cfg (e.g. "gcc_x64_dll/mswu"), sorted
+vector<string> find_local_configs(const string& prefix);
+
+/// the outcome of resolve_all_local_flags() for one config
+struct LocalConfigFlags {
+    string config;
+    string error; // empty on success
+    WxFlags flags;
+};
+
+/**
+ * @brief parse the build.cfg of every config in `configs` concurrently and resolve their flags. Does not touch the
+ * state used by parse_build_cfg() / get_build_cfg()
+ */
+vector<LocalConfigFlags> resolve_all_local_flags(
+    const vector<string>& libs, const string& prefix, const vector<string>& configs);
+
+/// forget everything we learned about the install tree
+void reset_local_state();
+
+#endif // LOCAL_INSTALL_HPP
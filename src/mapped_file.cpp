@@ -0,0 +1,135 @@
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+FileStamp get_file_stamp(const string& path)
+{
+    FileStamp stamp;
+#ifdef _WIN32
+    // the last write time in 100 ns units (_stat64 rounds it to the second) and the size, from a single call
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if(!::GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data)) {
+        return stamp;
+    }
+    // 100 ns ticks since 1601 -> ns since 1970, like the other platforms
+    int64_t ticks = (int64_t(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+    stamp.exists = true;
+    stamp.mtime = (ticks - 116444736000000000LL) * 100;
+    stamp.size = (uint64_t(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+    return stamp;
+#else
+    struct stat st;
+    if(::stat(path.c_str(), &st) != 0) {
+        return stamp;
+    }
+#ifdef __APPLE__
+    stamp.mtime = int64_t(st.st_mtimespec.tv_sec) * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+    stamp.mtime = int64_t(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+    stamp.exists = true;
+    stamp.size = static_cast<uint64_t>(st.st_size);
+    return stamp;
+#endif
+}
+
+#ifdef _WIN32
+bool MappedFile::open(const string& path)
+{
+    close();
+    m_file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(m_file == INVALID_HANDLE_VALUE) {
+        m_file = nullptr;
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if(!::GetFileSizeEx(m_file, &size)) {
+        close();
+        return false;
+    }
+    m_size = static_cast<size_t>(size.QuadPart);
+    if(m_size == 0) {
+        // empty files can not be mapped
+        return true;
+    }
+
+    m_mapping = ::CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(!m_mapping) {
+        close();
+        return false;
+    }
+    m_data = static_cast<const char*>(::MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if(!m_data) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close()
+{
+    if(m_data) {
+        ::UnmapViewOfFile(m_data);
+    }
+    if(m_mapping) {
+        ::CloseHandle(m_mapping);
+    }
+    if(m_file) {
+        ::CloseHandle(m_file);
+    }
+    m_data = nullptr;
+    m_mapping = nullptr;
+    m_file = nullptr;
+    m_size = 0;
+}
+#else
+bool MappedFile::open(const string& path)
+{
+    close();
+    m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(m_fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if(::fstat(m_fd, &st) != 0) {
+        close();
+        return false;
+    }
+    m_size = static_cast<size_t>(st.st_size);
+    if(m_size == 0) {
+        // empty files can not be mapped
+        return true;
+    }
+
+    void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if(data == MAP_FAILED) {
+        close();
+        return false;
+    }
+    m_data = static_cast<const char*>(data);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if(m_data) {
+        ::munmap(const_cast<char*>(m_data), m_size);
+    }
+    if(m_fd >= 0) {
+        ::close(m_fd);
+    }
+    m_data = nullptr;
+    m_fd = -1;
+    m_size = 0;
+}
+#endif
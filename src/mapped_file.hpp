@@ -0,0 +1,54 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+/**
+ * @brief modification time (in the platform's native resolution) and size of a file, from a single stat call
+ */
+struct FileStamp {
+    bool exists = false;
+    int64_t mtime = 0;
+    uint64_t size = 0;
+
+    bool operator==(const FileStamp& other) const
+    {
+        return exists == other.exists && mtime == other.mtime && size == other.size;
+    }
+};
+
+FileStamp get_file_stamp(const string& path);
+
+/**
+ * @brief a read-only memory mapping of a whole file
+ */
+class MappedFile
+{
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+
+    void close();
+
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// map `path`. Return false if the file can not be opened
+    bool open(const string& path);
+
+    string_view view() const { return string_view(m_data ? m_data : "", m_size); }
+};
+
+#endif // MAPPED_FILE_HPP
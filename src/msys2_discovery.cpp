@@ -0,0 +1,300 @@
+#include "msys2_discovery.hpp"
+
+#include "cache.hpp"
+#include "mapped_file.hpp"
+#include "msys2_install.hpp"
+#include "trace.hpp"
+#include "utils.hpp"
+#include "wx_flags.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+/// the layout of the index file. Bump this when the format changes
+constexpr const char* kIndexFormat = "wx-config-msys2-discovery-1";
+
+/// the MSYS2 environments that ship wxWidgets, in order of preference when the policy finds no better match
+constexpr const char* kMsys2Envs[] = { "ucrt64", "clang64", "mingw64", "clangarm64", "mingw32", "clang32" };
+
+constexpr int kDefaultBudgetMs = 200;
+
+#ifdef _WIN32
+constexpr char kPathListSep = ';';
+#else
+constexpr char kPathListSep = ':';
+#endif
+
+vector<string> split_path_list(const string& list)
+{
+    vector<string> paths;
+    string token;
+    istringstream iss(list);
+    while(getline(iss, token, kPathListSep)) {
+        trim(token);
+        if(!token.empty()) {
+            paths.push_back(normalize_path(token));
+        }
+    }
+    return paths;
+}
+
+/// the prefix (<root>/<env>) of the C++ compiler found in PATH, empty if there is none
+string get_compiler_prefix()
+{
+    string compiler = safe_getenv("CXX");
+    compiler = compiler.substr(0, compiler.find_first_of(" \t"));
+    string path;
+    for(const string& name : { compiler, string("g++"), string("clang++") }) {
+        if(!name.empty() && !(path = find_program(name)).empty()) {
+            break;
+        }
+    }
+    if(path.empty()) {
+        return "";
+    }
+    // <prefix>/bin/g++
+    return normalize_path(filesystem::path(path).parent_path().parent_path().string());
+}
+
+/// the environment variables the discovery outcome depends on
+string get_index_key()
+{
+    stringstream ss;
+    ss << kIndexFormat << '\0';
+    for(const char* name : { "MSYSTEM", "WXCONFIG_MSYS2_ENV", "WXCONFIG_MSYS2_ROOTS", "CXX", "PATH" }) {
+        ss << name << "=" << safe_getenv(name) << '\0';
+    }
+    return to_hex(fnv1a_64(ss.str()));
+}
+
+string get_index_path()
+{
+    if(!safe_getenv("WXCONFIG_NO_CACHE").empty()) {
+        return "";
+    }
+    string dir = get_cache_dir();
+    return dir.empty() ? "" : dir + DIR_SEP_STR "msys2-discovery";
+}
+
+string lib_dir_stamp(const string& prefix)
+{
+    FileStamp stamp = get_file_stamp(prefix + "/lib");
+    return stamp.exists ? to_string(stamp.mtime) : "-";
+}
+
+/**
+ * @brief the prefix recorded in the index, if the index was written for the same environment and none of the probed
+ * lib dirs changed since. A lib dir that appears or gets a new wxWidgets changes its stamp, so does one that goes away
+ */
+optional<string> read_index(const string& index_path, const string& key)
+{
+    ifstream in_file(index_path, ios::binary);
+    string line, prefix;
+    if(!getline(in_file, line) || line != kIndexFormat || !getline(in_file, line) || line != key
+       || !getline(in_file, prefix)) {
+        return nullopt;
+    }
+    // <stamp> <prefix> of every candidate
+    while(getline(in_file, line)) {
+        size_t sep = line.find(' ');
+        if(sep == string::npos || line.substr(0, sep) != lib_dir_stamp(line.substr(sep + 1))) {
+            return nullopt;
+        }
+    }
+    return prefix;
+}
+
+void write_index(const string& index_path, const string& key, const string& prefix, const vector<string>& candidates)
+{
+    stringstream ss;
+    ss << kIndexFormat << "\n" << key << "\n" << prefix << "\n";
+    for(const auto& candidate : candidates) {
+        ss << lib_dir_stamp(candidate) << " " << candidate << "\n";
+    }
+    error_code ec;
+    filesystem::create_directories(get_cache_dir(), ec);
+    write_file_if_changed(index_path, ss.str());
+}
+
+/// "3.2" -> { 3, 2 }
+pair<int, int> parse_version(const string& version)
+{
+    int major = 0, minor = 0;
+    char dot = 0;
+    istringstream iss(version);
+    iss >> major >> dot >> minor;
+    return { major, minor };
+}
+
+size_t env_rank(const string& env)
+{
+    size_t count = sizeof(kMsys2Envs) / sizeof(kMsys2Envs[0]);
+    return find(kMsys2Envs, kMsys2Envs + count, env) - kMsys2Envs;
+}
+
+bool is_same_dir(const string& a, const string& b)
+{
+    error_code ec;
+    return !a.empty() && !b.empty() && filesystem::equivalent(a, b, ec);
+}
+
+/// the probe threads not done yet, of every discovery. Trivially destructible: the threads may outlive main()
+atomic<size_t> running_probes = 0;
+
+/// the probes of one discovery, shared with the worker threads that may outlive it
+struct ProbeState {
+    mutex guard;
+    condition_variable done;
+    size_t pending = 0;
+    vector<optional<Msys2Install>> results;
+};
+}
+
+vector<string> get_msys2_candidate_prefixes()
+{
+    vector<string> roots = split_path_list(safe_getenv("WXCONFIG_MSYS2_ROOTS"));
+    if(roots.empty()) {
+#ifdef _WIN32
+        roots = { "C:/msys64", "C:/msys32", "C:/tools/msys64" };
+#endif
+        // the MSYS2 root of the compiler in PATH, wherever it was installed
+        string compiler_prefix = get_compiler_prefix();
+        if(!compiler_prefix.empty()) {
+            roots.push_back(normalize_path(filesystem::path(compiler_prefix).parent_path().string()));
+        }
+    }
+
+    vector<string> prefixes;
+    for(const auto& root : roots) {
+        for(const char* env : kMsys2Envs) {
+            string prefix = root + DIR_SEP + env;
+            if(find(prefixes.begin(), prefixes.end(), prefix) == prefixes.end()) {
+                prefixes.push_back(prefix);
+            }
+        }
+    }
+    return prefixes;
+}
+
+vector<Msys2Install> probe_msys2_installs(const vector<string>& prefixes, chrono::milliseconds budget, bool& complete)
+{
+    auto deadline = chrono::steady_clock::now() + budget;
+    auto state = make_shared<ProbeState>();
+    state->pending = prefixes.size();
+    state->results.resize(prefixes.size());
+
+    // one thread per prefix: the probes wait on the file system (a cold disk, a network drive), not on the CPU. The
+    // threads are detached so a stuck probe can not hold the caller past its budget
+    for(size_t i = 0; i < prefixes.size(); ++i) {
+        ++running_probes;
+        thread([state, i, prefix = prefixes[i]]() mutable {
+            optional<Msys2Install> install;
+            string version;
+            if(detect_wx_version(prefix + "/lib", version) == kVersionOk) {
+                string env = filesystem::path(prefix).filename().string();
+                install = Msys2Install { prefix, env, version };
+            }
+            {
+                lock_guard lock(state->guard);
+                state->results[i] = move(install);
+                --state->pending;
+                state->done.notify_all();
+            }
+            // release everything before the count drops: finish_msys2_probes() may end the process once it reads zero
+            state.reset();
+            prefix = string();
+            --running_probes;
+        }).detach();
+    }
+
+    unique_lock lock(state->guard);
+    complete = state->done.wait_until(lock, deadline, [&state]() { return state->pending == 0; });
+    vector<Msys2Install> installs;
+    for(const auto& result : state->results) {
+        if(result) {
+            installs.push_back(*result);
+        }
+    }
+    return installs;
+}
+
+const Msys2Install* select_msys2_install(const vector<Msys2Install>& installs, const string& compiler_prefix)
+{
+    string wanted_env = safe_getenv("WXCONFIG_MSYS2_ENV");
+    if(wanted_env.empty()) {
+        wanted_env = safe_getenv("MSYSTEM");
+    }
+    transform(wanted_env.begin(), wanted_env.end(), wanted_env.begin(), [](unsigned char ch) { return tolower(ch); });
+
+    const Msys2Install* best = nullptr;
+    auto rank = [&](const Msys2Install& install) {
+        // compared as a tuple, the lower the better
+        return make_tuple(install.env == wanted_env ? 0 : 1, is_same_dir(install.prefix, compiler_prefix) ? 0 : 1,
+            -parse_version(install.version).first, -parse_version(install.version).second, env_rank(install.env));
+    };
+    for(const auto& install : installs) {
+        if(best == nullptr || rank(install) < rank(*best)) {
+            best = &install;
+        }
+    }
+    return best;
+}
+
+int finish_msys2_probes(int code)
+{
+    cout.flush();
+    cerr.flush();
+    if(running_probes > 0) {
+        fflush(nullptr);
+        _Exit(code);
+    }
+    return code;
+}
+
+string discover_msys2_prefix()
+{
+    TraceScope scope("discover_prefix");
+    string key = get_index_key();
+    string index_path = get_index_path();
+    if(!index_path.empty()) {
+        optional<string> prefix = read_index(index_path, key);
+        if(prefix) {
+            return *prefix;
+        }
+    }
+
+    int budget_ms = kDefaultBudgetMs;
+    string budget_env = safe_getenv("WXCONFIG_DISCOVERY_BUDGET_MS");
+    if(!budget_env.empty()) {
+        budget_ms = max(1, atoi(budget_env.c_str()));
+    }
+
+    vector<string> candidates = get_msys2_candidate_prefixes();
+    bool complete = false;
+    vector<Msys2Install> installs = probe_msys2_installs(candidates, chrono::milliseconds(budget_ms), complete);
+    const Msys2Install* install = select_msys2_install(installs, get_compiler_prefix());
+    string prefix = install ? install->prefix : "";
+    if(!complete) {
+        // a partial probe may have missed the better match: do not record it, let the next run try again
+        if(prefix.empty()) {
+            cerr << "wx-config-msys2: the MSYS2 discovery did not complete within " << budget_ms
+                 << " ms (WXCONFIG_DISCOVERY_BUDGET_MS)" << endl;
+        }
+    } else if(!index_path.empty()) {
+        write_index(index_path, key, prefix, candidates);
+    }
+    return prefix;
+}
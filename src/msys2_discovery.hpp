@@ -0,0 +1,57 @@
+#ifndef MSYS2_DISCOVERY_HPP
+#define MSYS2_DISCOVERY_HPP
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/// an MSYS2 environment with wxWidgets installed
+struct Msys2Install {
+    string prefix;  // e.g. C:/msys64/ucrt64
+    string env;     // e.g. ucrt64
+    string version; // the newest wxWidgets version installed, e.g. "3.2"
+};
+
+/**
+ * @brief the prefixes that may hold an MSYS2 environment: every environment (ucrt64, clang64, ...) of every MSYS2
+ * root. The roots are WXCONFIG_MSYS2_ROOTS (a PATH like list) when set, otherwise the usual install locations plus the
+ * root of the compiler found in PATH
+ */
+vector<string> get_msys2_candidate_prefixes();
+
+/**
+ * @brief detect the wxWidgets version of every prefix concurrently and return the installs found within `budget`, in
+ * the order of `prefixes`. `complete` is false when some probes did not answer in time (they are left to finish in the
+ * background, their result is dropped)
+ */
+vector<Msys2Install> probe_msys2_installs(const vector<string>& prefixes, chrono::milliseconds budget, bool& complete);
+
+/**
+ * @brief pick the install to use: the environment named by WXCONFIG_MSYS2_ENV or MSYSTEM, then the one holding
+ * `compiler_prefix` (the prefix of the compiler found in PATH), then the newest wxWidgets version. Null if `installs`
+ * is empty
+ */
+const Msys2Install* select_msys2_install(const vector<Msys2Install>& installs, const string& compiler_prefix);
+
+/**
+ * @brief the prefix to use when neither --prefix nor WXWIN is given, empty if no MSYS2 environment has wxWidgets.
+ *
+ * The outcome is kept in an index file under the cache dir, together with the stamps of the probed directories and a
+ * hash of the environment variables the selection depends on: while none of them changes, later runs read the prefix
+ * from the index and skip the probe. The probe itself is bounded by WXCONFIG_DISCOVERY_BUDGET_MS (200 ms by default)
+ */
+string discover_msys2_prefix();
+
+/**
+ * @brief flush the standard streams and return `code`, the exit code of the process. Call it last in main().
+ *
+ * A probe that misses its budget keeps running in a detached thread, and a thread still running while the static
+ * objects are destroyed is undefined behavior. So when a probe is still running, this ends the process right away
+ * with _Exit(code). Static destructors and atexit handlers are skipped, and the caller writes its trace line first.
+ * Waiting for the probe is not an option: a probe stuck on a network drive must not hold the build
+ */
+int finish_msys2_probes(int code);
+
+#endif // MSYS2_DISCOVERY_HPP
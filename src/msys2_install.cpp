@@ -0,0 +1,136 @@
+#include "msys2_install.hpp"
+
+#include "flag_catalog.hpp"
+#include "lib_catalog.hpp"
+#include "server.hpp"
+#include "utils.hpp"
+
+#include <filesystem>
+#include <iostream>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+/// lib dir -> detected wxWidgets version. Kept for the lifetime of the process (relevant for --server)
+unordered_map<string, string> wx_versions;
+}
+
+/// forget everything we learned about the install tree
+void reset_msys2_state()
+{
+    wx_versions.clear();
+}
+
+string find_wx_version(const string& install_dir)
+{
+    // check if the user provided us with a version to use
+    string user_ver = safe_getenv("WXVER");
+    if(!user_ver.empty()) {
+        return user_ver;
+    }
+
+    auto iter = wx_versions.find(install_dir);
+    if(iter != wx_versions.end()) {
+        return iter->second;
+    }
+
+    string version;
+    switch(detect_wx_version(install_dir, version)) {
+    case kVersionNoDirectory:
+        cerr << "Directory: " << install_dir << " does not exist" << endl;
+        cerr << "Could not determine wxWidgets version installed. Please set WXVER or ensure that the --prefix "
+                "provided is correct"
+             << endl;
+        fatal_exit(4);
+    case kVersionNotFound:
+        cerr << "Could not determine wxWidgets version installed. Please set WXVER or ensure that the --prefix "
+                "provided is correct"
+             << endl;
+        fatal_exit(3);
+    case kVersionOk:
+        break;
+    }
+
+    server_watch(install_dir);
+    wx_versions.insert({ install_dir, version });
+    return version;
+}
+
+VersionResult detect_wx_version(const string& install_dir, string& version)
+{
+    size_t cur_weight = 0;
+    string major, minor;
+    error_code ec;
+    filesystem::directory_iterator iter(install_dir, ec);
+    if(ec) {
+        return kVersionNoDirectory;
+    }
+
+    for(; iter != filesystem::directory_iterator(); iter.increment(ec)) {
+        if(ec) {
+            return kVersionNoDirectory;
+        }
+        const auto& entry = *iter;
+#ifdef _WIN32
+        auto path = entry.path().string();
+#else
+        // avoid copying the path on POSIX, native() is already a narrow string
+        const auto& path = entry.path().native();
+#endif
+        string_view tmp_major, tmp_minor;
+        if(match_wx_base_version(path, tmp_major, tmp_minor)) {
+            size_t weight = wx_version_weight(tmp_major, tmp_minor);
+            if(weight > cur_weight) {
+                major = tmp_major;
+                minor = tmp_minor;
+                cur_weight = weight;
+            }
+        }
+    }
+
+    if(cur_weight == 0) {
+        return kVersionNotFound;
+    }
+    version = major + "." + minor;
+    return kVersionOk;
+}
+
+string get_msys2_lib_name(const string& lib, const string& wx_ver)
+{
+    // e.g. wx_baseu-3.2, wx_baseu_xml-3.2 or wx_mswu_core-3.2
+    int index = find_wx_lib(lib);
+    if(index < 0) {
+        return "";
+    }
+    string name;
+    append_msys2_lib_name(index, wx_ver, [&](string_view part) { name += part; });
+    return name;
+}
+
+/// resolve all the flags for the wx version `wx_ver` (e.g. "-3.2") installed under `prefix`
+WxFlags resolve_msys2_flags(const vector<string>& libs, const string& prefix, const string& wx_ver)
+{
+    WxFlags flags;
+    flags.tool = "wx-config-msys2";
+    flags.prefix = prefix;
+    flags.version = wx_ver.substr(1);
+    // MSYS2 ships release, unicode, non monolithic DLL builds
+    flags.build = "release";
+    flags.shared = true;
+
+    for(string_view dir : kMsys2IncludeDirs) {
+        flags.include_dirs.push_back(prefix + string(dir) + wx_ver);
+    }
+    flags.compile_flags.assign(begin(kGccCompileFlags), end(kGccCompileFlags));
+    flags.compile_flags.insert(flags.compile_flags.end(), begin(kMswCompileFlags), end(kMswCompileFlags));
+    flags.rc_defines.assign(begin(kRcDefines), end(kRcDefines));
+
+    flags.lib_dirs = { prefix + "/lib" };
+    flags.link_flags.assign(begin(kLinkFlags), end(kLinkFlags));
+    for(const auto& lib : libs) {
+        flags.libs.push_back(get_msys2_lib_name(lib, wx_ver));
+    }
+    return flags;
+}
@@ -0,0 +1,37 @@
+#ifndef MSYS2_INSTALL_HPP
+#define MSYS2_INSTALL_HPP
+
+#include "utils.hpp"
+#include "wx_flags.hpp"
+
+#include <string>
+
+using namespace std;
+
+/**
+ * @brief detect the newest wxWidgets version installed in `install_dir` (<prefix>/lib), e.g. "3.2". WXVER overrides
+ * the detection. The result is remembered per directory until reset_msys2_state() is called
+ */
+string find_wx_version(const string& install_dir);
+
+enum VersionResult {
+    kVersionOk,
+    kVersionNoDirectory, // `install_dir` can not be read
+    kVersionNotFound,    // no wx_baseu-<major>.<minor> library in it
+};
+
+/**
+ * @brief the newest wxWidgets version installed in `install_dir`, without looking at WXVER or remembering the result
+ */
+VersionResult detect_wx_version(const string& install_dir, string& version);
+
+/// the link name of `lib` for the version `wx_ver` (e.g. "core", "-3.2" -> "wx_mswu_core-3.2"), empty if unknown
+string get_msys2_lib_name(const string& lib, const string& wx_ver);
+
+/// resolve all the flags of the wx `libs` (see expand_libs()) for the version `wx_ver` (e.g. "-3.2") under `prefix`
+WxFlags resolve_msys2_flags(const vector<string>& libs, const string& prefix, const string& wx_ver);
+
+/// forget everything we learned about the install tree
+void reset_msys2_state();
+
+#endif // MSYS2_INSTALL_HPP
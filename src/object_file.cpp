@@ -0,0 +1,363 @@
+#include "object_file.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace
+{
+// all reads are bounds checked by the callers, these only assemble the bytes
+uint16_t read_le16(const char* p)
+{
+    auto u = reinterpret_cast<const unsigned char*>(p);
+    return uint16_t(u[0] | (u[1] << 8));
+}
+
+uint32_t read_le32(const char* p)
+{
+    auto u = reinterpret_cast<const unsigned char*>(p);
+    return uint32_t(u[0]) | (uint32_t(u[1]) << 8) | (uint32_t(u[2]) << 16) | (uint32_t(u[3]) << 24);
+}
+
+uint64_t read_le64(const char* p) { return uint64_t(read_le32(p)) | (uint64_t(read_le32(p + 4)) << 32); }
+
+uint32_t read_be32(const char* p)
+{
+    auto u = reinterpret_cast<const unsigned char*>(p);
+    return (uint32_t(u[0]) << 24) | (uint32_t(u[1]) << 16) | (uint32_t(u[2]) << 8) | uint32_t(u[3]);
+}
+
+uint64_t read_be64(const char* p) { return (uint64_t(read_be32(p)) << 32) | uint64_t(read_be32(p + 4)); }
+
+/// the NUL terminated string at `offset` of `table`, or an empty view if it runs out of the table
+string_view c_string_at(string_view table, size_t offset)
+{
+    if(offset >= table.length()) {
+        return {};
+    }
+    size_t end = table.find('\0', offset);
+    if(end == string_view::npos) {
+        return {};
+    }
+    return table.substr(offset, end - offset);
+}
+
+constexpr string_view kArchiveMagic = "!<arch>\n";
+constexpr size_t kArchiveHeaderSize = 60;
+
+/**
+ * @brief call `callback(name, content)` for every member of the ar archive `data`. The special GNU members (`/`,
+ * `//` and `/SYM64/`) are reported with their raw names. Stop when the callback returns false
+ */
+bool for_each_archive_member(string_view data, const function<bool(string_view name, string_view content)>& callback)
+{
+    if(!data.starts_with(kArchiveMagic)) {
+        return false;
+    }
+
+    string_view long_names;
+    size_t pos = kArchiveMagic.length();
+    while(pos + kArchiveHeaderSize <= data.length()) {
+        string_view header = data.substr(pos, kArchiveHeaderSize);
+        if(header.substr(58, 2) != "`\n") {
+            return false;
+        }
+
+        size_t size = 0;
+        for(char ch : header.substr(48, 10)) {
+            if(ch < '0' || ch > '9') {
+                break;
+            }
+            size = size * 10 + (ch - '0');
+        }
+        pos += kArchiveHeaderSize;
+        if(size > data.length() - pos) {
+            return false;
+        }
+
+        string_view content = data.substr(pos, size);
+        string_view name = header.substr(0, 16);
+        name = name.substr(0, name.find_last_not_of(' ') + 1);
+        if(name.starts_with("#1/")) {
+            // BSD: the name follows the header and is included in the size
+            size_t name_length = 0;
+            for(char ch : name.substr(3)) {
+                name_length = name_length * 10 + (ch - '0');
+            }
+            name_length = min(name_length, content.length());
+            name = content.substr(0, name_length);
+            name = name.substr(0, name.find('\0'));
+            content = content.substr(name_length);
+        } else if(name == "//") {
+            long_names = content;
+        } else if(name.length() > 1 && name[0] == '/' && name[1] >= '0' && name[1] <= '9') {
+            // GNU: "/<offset into the long names member>", terminated by "/\n"
+            size_t offset = 0;
+            for(char ch : name.substr(1)) {
+                offset = offset * 10 + (ch - '0');
+            }
+            name = offset < long_names.length() ? long_names.substr(offset) : string_view();
+            name = name.substr(0, name.find_first_of("/\n"));
+        } else if(name.length() > 1 && name.ends_with('/') && name != "/SYM64/") {
+            name.remove_suffix(1);
+        }
+
+        if(!callback(name, content)) {
+            return true;
+        }
+        // members start at even offsets
+        pos += size + (size & 1);
+    }
+    return true;
+}
+
+bool is_coff_machine(uint16_t machine)
+{
+    switch(machine) {
+    case 0x014c: // i386
+    case 0x8664: // x86-64
+    case 0x01c4: // ARMv7 thumb
+    case 0xaa64: // ARM64
+    case 0xa64e: // ARM64EC
+        return true;
+    default:
+        return false;
+    }
+}
+
+constexpr uint8_t kCoffClassExternal = 2;
+
+/// walk a COFF symbol table with `symbol_size` (18 regular, 20 bigobj) bytes per record
+bool scan_coff_symbols(string_view data, size_t symtab_offset, size_t symbol_count, size_t symbol_size,
+    const SymbolCallback& callback)
+{
+    if(symtab_offset > data.length() || symbol_count > (data.length() - symtab_offset) / symbol_size) {
+        return false;
+    }
+    // the string table follows the symbols and starts with its own size
+    string_view strings = data.substr(symtab_offset + symbol_count * symbol_size);
+    if(strings.length() >= 4) {
+        strings = strings.substr(0, min<size_t>(read_le32(strings.data()), strings.length()));
+    }
+
+    bool is_bigobj = symbol_size == 20;
+    for(size_t i = 0; i < symbol_count; ++i) {
+        const char* symbol = data.data() + symtab_offset + i * symbol_size;
+        int32_t section = is_bigobj ? int32_t(read_le32(symbol + 12)) : int16_t(read_le16(symbol + 12));
+        uint8_t storage_class = uint8_t(symbol[is_bigobj ? 18 : 16]);
+        uint8_t aux_count = uint8_t(symbol[is_bigobj ? 19 : 17]);
+        // skip the auxiliary records
+        size_t record = i;
+        i += aux_count;
+
+        if(storage_class != kCoffClassExternal) {
+            continue;
+        }
+
+        string_view name;
+        if(read_le32(symbol) == 0) {
+            name = c_string_at(strings, read_le32(symbol + 4));
+        } else {
+            name = string_view(symbol, 8);
+            name = name.substr(0, name.find('\0'));
+        }
+        if(name.empty()) {
+            continue;
+        }
+
+        // an undefined symbol with a value is a common symbol, which the object defines
+        bool undefined = section == 0 && read_le32(data.data() + symtab_offset + record * symbol_size + 8) == 0;
+        if(undefined || section > 0) {
+            callback(name, !undefined);
+        }
+    }
+    return true;
+}
+
+/// short import member of an import library: defines `__imp_<name>` (and `<name>` for functions)
+bool scan_coff_import(string_view data, const SymbolCallback& callback)
+{
+    constexpr size_t header_size = 20;
+    if(data.length() < header_size) {
+        return false;
+    }
+    string_view name = c_string_at(data, header_size);
+    if(name.empty()) {
+        return false;
+    }
+
+    // the import type is stored in the two low bits: 0 code, 1 data, 2 const
+    uint16_t type = read_le16(data.data() + 18) & 0x3;
+    string imp_name = "__imp_";
+    imp_name.append(name);
+    callback(imp_name, true);
+    if(type == 0) {
+        callback(name, true);
+    }
+    return true;
+}
+
+bool scan_coff(string_view data, const SymbolCallback& callback)
+{
+    constexpr unsigned char bigobj_class_id[16] = { 0xC7, 0xA1, 0xBA, 0xD1, 0xEE, 0xBA, 0xA9, 0x4B, 0xAF, 0x20, 0xFA,
+        0xF6, 0x6A, 0xA4, 0xDC, 0xB8 };
+
+    if(data.length() < 20) {
+        return false;
+    }
+
+    uint16_t sig1 = read_le16(data.data());
+    uint16_t sig2 = read_le16(data.data() + 2);
+    if(sig1 == 0 && sig2 == 0xFFFF) {
+        uint16_t version = read_le16(data.data() + 4);
+        if(version == 0) {
+            return scan_coff_import(data, callback);
+        }
+        // ANON_OBJECT_HEADER_BIGOBJ
+        if(data.length() < 56 || memcmp(data.data() + 12, bigobj_class_id, sizeof(bigobj_class_id)) != 0
+           || !is_coff_machine(read_le16(data.data() + 6))) {
+            return false;
+        }
+        return scan_coff_symbols(data, read_le32(data.data() + 48), read_le32(data.data() + 52), 20, callback);
+    }
+
+    if(!is_coff_machine(sig1)) {
+        return false;
+    }
+    return scan_coff_symbols(data, read_le32(data.data() + 8), read_le32(data.data() + 12), 18, callback);
+}
+
+bool scan_elf(string_view data, const SymbolCallback& callback)
+{
+    constexpr uint32_t sht_symtab = 2;
+    constexpr uint16_t shn_undef = 0;
+    constexpr uint8_t stb_global = 1;
+    constexpr uint8_t stb_weak = 2;
+
+    if(data.length() < 52 || !data.starts_with("\x7f" "ELF")) {
+        return false;
+    }
+    bool is_64 = data[4] == 2;
+    if(data[5] != 1) {
+        // big endian
+        return false;
+    }
+    if(is_64 && data.length() < 64) {
+        return false;
+    }
+
+    const char* base = data.data();
+    uint64_t shoff = is_64 ? read_le64(base + 0x28) : read_le32(base + 0x20);
+    uint16_t shentsize = read_le16(base + (is_64 ? 0x3A : 0x2E));
+    uint16_t shnum = read_le16(base + (is_64 ? 0x3C : 0x30));
+    if(shentsize < (is_64 ? 64 : 40) || shoff > data.length() || shnum > (data.length() - shoff) / shentsize) {
+        return false;
+    }
+
+    struct Section {
+        uint32_t type;
+        uint64_t offset;
+        uint64_t size;
+        uint32_t link;
+        uint64_t entsize;
+    };
+    auto section_at = [&](size_t index) {
+        const char* sh = base + shoff + index * shentsize;
+        if(is_64) {
+            return Section { read_le32(sh + 4), read_le64(sh + 0x18), read_le64(sh + 0x20), read_le32(sh + 0x28),
+                read_le64(sh + 0x38) };
+        }
+        return Section { read_le32(sh + 4), read_le32(sh + 0x10), read_le32(sh + 0x14), read_le32(sh + 0x18),
+            read_le32(sh + 0x24) };
+    };
+    auto in_bounds = [&](const Section& section) {
+        return section.offset <= data.length() && section.size <= data.length() - section.offset;
+    };
+
+    size_t symbol_size = is_64 ? 24 : 16;
+    for(size_t i = 0; i < shnum; ++i) {
+        Section symtab = section_at(i);
+        if(symtab.type != sht_symtab) {
+            continue;
+        }
+        if(symtab.entsize != symbol_size || symtab.link >= shnum || !in_bounds(symtab)) {
+            return false;
+        }
+        Section strtab = section_at(symtab.link);
+        if(!in_bounds(strtab)) {
+            return false;
+        }
+        string_view strings = data.substr(strtab.offset, strtab.size);
+
+        size_t count = symtab.size / symbol_size;
+        for(size_t j = 1; j < count; ++j) {
+            const char* symbol = base + symtab.offset + j * symbol_size;
+            uint8_t info = uint8_t(symbol[is_64 ? 4 : 12]);
+            uint16_t shndx = read_le16(symbol + (is_64 ? 6 : 14));
+            uint8_t binding = info >> 4;
+            if(binding != stb_global && binding != stb_weak) {
+                continue;
+            }
+            string_view name = c_string_at(strings, read_le32(symbol));
+            if(!name.empty()) {
+                callback(name, shndx != shn_undef);
+            }
+        }
+    }
+    return true;
+}
+}
+
+bool scan_object_symbols(string_view data, const SymbolCallback& callback)
+{
+    if(data.starts_with(kArchiveMagic)) {
+        return for_each_archive_member(data, [&](string_view name, string_view content) {
+            if(name != "/" && name != "//" && name != "/SYM64/" && !name.starts_with("__.SYMDEF")) {
+                // members in an unknown format (resources, LTO bitcode...) do not matter here
+                scan_object_symbols(content, callback);
+            }
+            return true;
+        });
+    }
+    if(data.starts_with("\x7f" "ELF")) {
+        return scan_elf(data, callback);
+    }
+    return scan_coff(data, callback);
+}
+
+bool scan_archive_index(string_view data, const function<void(string_view name)>& callback)
+{
+    bool found = false;
+    bool ok = for_each_archive_member(data, [&](string_view name, string_view content) {
+        if(name != "/" && name != "/SYM64/") {
+            // the index is always the first member
+            return false;
+        }
+
+        // big endian count, count offsets, then the NUL terminated names
+        size_t word = name == "/" ? 4 : 8;
+        if(content.length() < word) {
+            return false;
+        }
+        uint64_t count = word == 4 ? read_be32(content.data()) : read_be64(content.data());
+        if(count > (content.length() - word) / word) {
+            return false;
+        }
+        found = true;
+
+        string_view names = content.substr(word + count * word);
+        size_t offset = 0;
+        for(uint64_t i = 0; i < count && offset < names.length(); ++i) {
+            string_view symbol = c_string_at(names, offset);
+            if(symbol.empty() && names[offset] != '\0') {
+                // unterminated name
+                break;
+            }
+            callback(symbol);
+            offset += symbol.length() + 1;
+        }
+        return false;
+    });
+    return ok && found;
+}
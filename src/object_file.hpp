@@ -0,0 +1,28 @@
+#ifndef OBJECT_FILE_HPP
+#define OBJECT_FILE_HPP
+
+#include <functional>
+#include <string_view>
+
+using namespace std;
+
+/// called for every external symbol of an object file. `defined` is false for symbols the object only references
+typedef function<void(string_view name, bool defined)> SymbolCallback;
+
+/**
+ * @brief report the external symbols of `data`, the content of an object file or of an `ar` archive of object files.
+ *
+ * Supported formats: COFF (regular, `/bigobj` and short import members as found in MinGW and MSVC import libraries)
+ * and little endian ELF (32 and 64 bit). Archive members in other formats are skipped. Return false if `data` is not
+ * one of these formats or is truncated
+ */
+bool scan_object_symbols(string_view data, const SymbolCallback& callback);
+
+/**
+ * @brief report the symbols listed in the index (`/` or `/SYM64/` member) of the GNU `ar` archive `data`. This is
+ * what the linker uses to decide whether an archive defines a symbol, and it is much cheaper than reading the members.
+ * Return false if `data` is not an archive or has no index
+ */
+bool scan_archive_index(string_view data, const function<void(string_view name)>& callback);
+
+#endif // OBJECT_FILE_HPP
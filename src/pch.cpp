@@ -0,0 +1,124 @@
+#include "pch.hpp"
+
+#include "cache.hpp"
+#include "mapped_file.hpp"
+#include "utils.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+namespace
+{
+/// bump this when the prelude or the layout of the pch directory changes
+constexpr const char* kPchFormat = "wx-config-pch-1";
+
+constexpr const char* kPrelude = "// Generated by wx-config --pch, do not edit\n"
+                                 "#ifndef WX_CONFIG_PCH_H\n"
+                                 "#define WX_CONFIG_PCH_H\n"
+                                 "#include <wx/wx.h>\n"
+                                 "#endif\n";
+
+string stamp_of(const string& path)
+{
+    FileStamp stamp = get_file_stamp(path);
+    if(!stamp.exists) {
+        return "-";
+    }
+    return to_string(stamp.mtime) + ":" + to_string(stamp.size);
+}
+
+bool is_clang(const string& compiler)
+{
+    return filesystem::path(compiler).filename().string().find("clang") != string::npos;
+}
+
+string unique_tmp_path(const string& path)
+{
+    random_device rd;
+    return path + ".tmp." + to_hex((uint64_t(rd()) << 32) | rd());
+}
+}
+
+string get_default_pch_compiler(const WxFlags& flags)
+{
+    string compiler = safe_getenv("CXX");
+    if(!compiler.empty()) {
+        return compiler;
+    }
+    return flags.compiler == "clang" ? "clang++" : "g++";
+}
+
+string build_pch(const WxFlags& flags, const string& compiler)
+{
+    string compiler_path = find_program(compiler);
+    if(compiler_path.empty()) {
+        cerr << "could not find the compiler: " << compiler << endl;
+        fatal_exit(1);
+    }
+    bool clang = is_clang(compiler_path);
+    vector<string> compile_flags = cflags_list(flags);
+
+    stringstream key;
+    key << kPchFormat << '\0' << compiler_path << '\0' << stamp_of(compiler_path) << '\0';
+    for(const auto& flag : compile_flags) {
+        key << flag << '\0';
+    }
+    // an upgraded wx install changes these
+    for(const auto& dir : flags.include_dirs) {
+        for(const char* header : { "wx/wx.h", "wx/setup.h" }) {
+            key << stamp_of(dir + DIR_SEP + header) << '\0';
+        }
+    }
+
+    string cache_dir = get_cache_dir();
+    if(cache_dir.empty()) {
+        cerr << "could not determine the cache directory, please set XDG_CACHE_HOME" << endl;
+        fatal_exit(1);
+    }
+    string pch_dir = cache_dir + DIR_SEP + "pch" + DIR_SEP + to_hex(fnv1a_64(key.str()));
+    string header = pch_dir + DIR_SEP + "wx_pch.h";
+    string output = header + (clang ? ".pch" : ".gch");
+
+    if(!get_file_stamp(output).exists) {
+        error_code ec;
+        filesystem::create_directories(pch_dir, ec);
+        if(!get_file_stamp(header).exists) {
+            string tmp_header = unique_tmp_path(header);
+            {
+                ofstream out_file(tmp_header, ios::binary | ios::trunc);
+                out_file << kPrelude;
+            }
+            filesystem::rename(tmp_header, header, ec);
+            if(ec) {
+                cerr << "failed to write " << header << ": " << ec.message() << endl;
+                filesystem::remove(tmp_header, ec);
+                fatal_exit(1);
+            }
+        }
+
+        // concurrent builds each compile into their own file, the last rename wins
+        string tmp_output = unique_tmp_path(output);
+        vector<string> command = { compiler_path };
+        command.insert(command.end(), compile_flags.begin(), compile_flags.end());
+        command.insert(command.end(), { "-x", "c++-header", header, "-o", tmp_output });
+        if(run_command(command) != 0) {
+            filesystem::remove(tmp_output, ec);
+            cerr << "failed to build the precompiled header: " << output << endl;
+            fatal_exit(1);
+        }
+        filesystem::rename(tmp_output, output, ec);
+        if(ec) {
+            filesystem::remove(tmp_output, ec);
+            cerr << "failed to write " << output << ": " << ec.message() << endl;
+            fatal_exit(1);
+        }
+    }
+
+    if(clang) {
+        return "-include-pch " + output;
+    }
+    return "-include " + header;
+}
@@ -0,0 +1,24 @@
+#ifndef PCH_HPP
+#define PCH_HPP
+
+#include "wx_flags.hpp"
+
+#include <string>
+
+using namespace std;
+
+/// the compiler --pch uses when none is given: $CXX, else clang++ or g++ depending on the wx build
+string get_default_pch_compiler(const WxFlags& flags);
+
+/**
+ * @brief build (or reuse) the precompiled wx prelude header (`#include <wx/wx.h>`) for `flags` with `compiler`, and
+ * return the flags a consumer adds to its compile line to use it.
+ *
+ * The header is compiled with exactly the --cflags output. The result lives under <cache dir>/pch/<key>, where the key
+ * covers the compiler (path, mtime and size), every compile flag and the wx/wx.h and wx/setup.h headers of the include
+ * dirs, so a new compiler, config or wx install gets its own precompiled header. GCC produces `wx_pch.h.gch`
+ * (used through `-include wx_pch.h`), clang produces `wx_pch.h.pch` (used through `-include-pch`)
+ */
+string build_pch(const WxFlags& flags, const string& compiler);
+
+#endif // PCH_HPP
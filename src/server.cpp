@@ -0,0 +1,412 @@
+#include "server.hpp"
+
+#include "utils.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+/// the environment variables that affect the query result, forwarded by the client. WXCONFIG_PREFIX_MAP is the default
+/// alias of --remap-prefix
+const char* kForwardedEnv[] = { "WXWIN", "WXCFG", "WXVER", "WXCONFIG_PREFIX_MAP" };
+
+QueryServer* active_server = nullptr;
+
+#ifdef __linux__
+constexpr uint32_t kMaxStrings = 1024;
+constexpr uint32_t kMaxStringLen = 1024 * 1024;
+
+/// the socket path. `dir` is set to the directory we create for it, left empty for an explicit $WXCONFIG_SOCKET
+string get_socket_path(const string& tool_name, string& dir)
+{
+    dir.clear();
+    string path = safe_getenv("WXCONFIG_SOCKET");
+    if(!path.empty()) {
+        return path;
+    }
+
+    dir = safe_getenv("XDG_RUNTIME_DIR");
+    if(!dir.empty()) {
+        dir += "/wx-config";
+    } else {
+        dir = "/tmp/wx-config-" + to_string(::getuid());
+    }
+    return dir + "/" + tool_name + ".sock";
+}
+
+/// /tmp is shared: only use a socket dir that is a real directory, ours, and closed to everyone else
+bool is_private_dir(const string& dir)
+{
+    struct stat st;
+    return ::lstat(dir.c_str(), &st) == 0 && S_ISDIR(st.st_mode) && st.st_uid == ::getuid()
+           && (st.st_mode & 0777) == 0700;
+}
+
+/// is the process on the other end of `fd` running as us?
+bool is_own_peer(int fd)
+{
+    ucred cred;
+    socklen_t len = sizeof(cred);
+    return ::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0 && cred.uid == ::getuid();
+}
+
+bool write_all(int fd, const char* buffer, size_t len)
+{
+    while(len > 0) {
+        ssize_t n = ::send(fd, buffer, len, MSG_NOSIGNAL);
+        if(n < 0 && errno == EINTR) {
+            continue;
+        }
+        if(n <= 0) {
+            return false;
+        }
+        buffer += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool read_all(int fd, char* buffer, size_t len)
+{
+    while(len > 0) {
+        ssize_t n = ::recv(fd, buffer, len, 0);
+        if(n < 0 && errno == EINTR) {
+            continue;
+        }
+        if(n <= 0) {
+            return false;
+        }
+        buffer += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool write_u32(int fd, uint32_t value) { return write_all(fd, reinterpret_cast<const char*>(&value), sizeof(value)); }
+bool read_u32(int fd, uint32_t& value) { return read_all(fd, reinterpret_cast<char*>(&value), sizeof(value)); }
+
+bool write_string(int fd, const string& str)
+{
+    return write_u32(fd, static_cast<uint32_t>(str.length())) && write_all(fd, str.data(), str.length());
+}
+
+bool read_string(int fd, string& str)
+{
+    uint32_t len = 0;
+    if(!read_u32(fd, len) || len > kMaxStringLen) {
+        return false;
+    }
+    str.resize(len);
+    return read_all(fd, str.data(), len);
+}
+
+bool make_socket_addr(const string& path, sockaddr_un& addr)
+{
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(path.length() >= sizeof(addr.sun_path)) {
+        return false;
+    }
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    return true;
+}
+
+int connect_to(const string& path)
+{
+    sockaddr_un addr;
+    if(!make_socket_addr(path, addr)) {
+        return -1;
+    }
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(fd < 0) {
+        return -1;
+    }
+    if(::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+#endif
+}
+
+void server_watch(const string& path)
+{
+    if(active_server) {
+        active_server->watch(path);
+    }
+}
+
+#ifdef __linux__
+QueryServer::~QueryServer()
+{
+    if(m_inotify_fd >= 0) {
+        ::close(m_inotify_fd);
+    }
+    if(active_server == this) {
+        active_server = nullptr;
+    }
+}
+
+void QueryServer::watch(const string& path)
+{
+    if(m_inotify_fd < 0) {
+        return;
+    }
+    uint32_t mask = IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF
+                    | IN_MOVE_SELF;
+    int wd = ::inotify_add_watch(m_inotify_fd, path.c_str(), mask);
+    if(wd >= 0) {
+        m_watches[wd] = path;
+    }
+}
+
+void QueryServer::drop_watches()
+{
+    for(const auto& [wd, path] : m_watches) {
+        ::inotify_rm_watch(m_inotify_fd, wd);
+    }
+    m_watches.clear();
+}
+
+void QueryServer::handle_client(int fd, const Handler& handler)
+{
+    // request: <count> <cwd> <env...> <argv...>
+    uint32_t count = 0;
+    size_t env_count = sizeof(kForwardedEnv) / sizeof(kForwardedEnv[0]);
+    if(!read_u32(fd, count) || count > kMaxStrings || count < env_count + 2) {
+        return;
+    }
+
+    vector<string> strings(count);
+    for(auto& str : strings) {
+        if(!read_string(fd, str)) {
+            return;
+        }
+    }
+
+    if(::chdir(strings[0].c_str()) != 0) {
+        write_u32(fd, 1) && write_string(fd, "") && write_string(fd, "wx-config server: invalid working directory\n");
+        return;
+    }
+
+    for(size_t i = 0; i < env_count; ++i) {
+        const string& value = strings[i + 1];
+        if(value.empty()) {
+            ::unsetenv(kForwardedEnv[i]);
+        } else {
+            ::setenv(kForwardedEnv[i], value.c_str(), 1);
+        }
+    }
+
+    vector<char*> argv;
+    for(size_t i = env_count + 1; i < strings.size(); ++i) {
+        argv.push_back(strings[i].data());
+    }
+    argv.push_back(nullptr);
+
+    // capture the query output
+    stringstream out, err;
+    auto cout_buf = cout.rdbuf(out.rdbuf());
+    auto cerr_buf = cerr.rdbuf(err.rdbuf());
+
+    int exit_code = 0;
+    try {
+        exit_code = handler(static_cast<int>(argv.size() - 1), argv.data());
+    } catch(const FatalExit& e) {
+        exit_code = e.code;
+    } catch(const exception& e) {
+        err << e.what() << endl;
+        exit_code = 1;
+    }
+
+    cout.rdbuf(cout_buf);
+    cerr.rdbuf(cerr_buf);
+
+    // reply: <exit code> <stdout> <stderr>
+    write_u32(fd, static_cast<uint32_t>(exit_code)) && write_string(fd, out.str()) && write_string(fd, err.str());
+}
+
+int QueryServer::run(const Handler& handler, const function<void()>& on_invalidate)
+{
+    string dir;
+    string path = get_socket_path(m_tool_name, dir);
+    sockaddr_un addr;
+    if(!make_socket_addr(path, addr)) {
+        cerr << "socket path is too long: " << path << endl;
+        return 1;
+    }
+
+    // a live server already owns the socket?
+    int probe = connect_to(path);
+    if(probe >= 0) {
+        ::close(probe);
+        cerr << "a server is already listening on: " << path << endl;
+        return 1;
+    }
+
+    if(!dir.empty()) {
+        if(::mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST) {
+            cerr << "failed to create: " << dir << ". " << strerror(errno) << endl;
+            return 1;
+        }
+        if(!is_private_dir(dir)) {
+            cerr << "refusing to use " << dir << ": it must be a directory owned by the current user, with mode 0700"
+                 << endl;
+            return 1;
+        }
+    }
+    ::unlink(path.c_str());
+
+    int listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(listen_fd < 0 || ::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+       || ::listen(listen_fd, SOMAXCONN) != 0) {
+        cerr << "failed to listen on: " << path << ". " << strerror(errno) << endl;
+        return 1;
+    }
+
+    m_inotify_fd = ::inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if(m_inotify_fd < 0) {
+        cerr << "failed to initialize inotify. " << strerror(errno) << endl;
+        return 1;
+    }
+
+    active_server = this;
+    set_fatal_exit_throws(true);
+    cerr << m_tool_name << " server listening on: " << path << endl;
+
+    pollfd fds[2] = {
+        { listen_fd, POLLIN, 0 },
+        { m_inotify_fd, POLLIN, 0 },
+    };
+
+    // inotify events are aligned on `struct inotify_event`
+    alignas(inotify_event) char events[4096];
+    while(true) {
+        if(::poll(fds, 2, -1) < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        // handle invalidations before answering, so a query never sees stale state
+        if(fds[1].revents & POLLIN) {
+            bool changed = false;
+            ssize_t len = 0;
+            while((len = ::read(m_inotify_fd, events, sizeof(events))) > 0) {
+                for(char* ptr = events; ptr < events + len;) {
+                    auto event = reinterpret_cast<inotify_event*>(ptr);
+                    if(!(event->mask & IN_IGNORED)) {
+                        changed = true;
+                    }
+                    ptr += sizeof(inotify_event) + event->len;
+                }
+            }
+            if(changed) {
+                drop_watches();
+                on_invalidate();
+            }
+        }
+
+        if(fds[0].revents & POLLIN) {
+            int client_fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if(client_fd >= 0) {
+                // clients are served one at a time: a stalled one may only hold the others back briefly
+                timeval timeout = { 1, 0 };
+                ::setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+                ::setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+                handle_client(client_fd, handler);
+                ::close(client_fd);
+            }
+        }
+    }
+
+    cerr << "server stopped. " << strerror(errno) << endl;
+    ::close(listen_fd);
+    ::unlink(path.c_str());
+    return 1;
+}
+
+bool forward_query(const string& tool_name, int argc, char** argv, int& exit_code)
+{
+    if(!safe_getenv("WXCONFIG_NO_SERVER").empty()) {
+        return false;
+    }
+
+    // never talk to a socket (or a server) another user could have planted
+    string dir;
+    string path = get_socket_path(tool_name, dir);
+    if(!dir.empty() && !is_private_dir(dir)) {
+        return false;
+    }
+    int fd = connect_to(path);
+    if(fd < 0) {
+        return false;
+    }
+    if(!is_own_peer(fd)) {
+        ::close(fd);
+        return false;
+    }
+
+    // never let a stuck server stall the build, fall back to in-process evaluation instead
+    timeval timeout = { 10, 0 };
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    char cwd[4096];
+    bool ok = ::getcwd(cwd, sizeof(cwd)) != nullptr;
+    size_t env_count = sizeof(kForwardedEnv) / sizeof(kForwardedEnv[0]);
+    ok = ok && write_u32(fd, static_cast<uint32_t>(1 + env_count + argc)) && write_string(fd, cwd);
+    for(size_t i = 0; ok && i < env_count; ++i) {
+        ok = write_string(fd, safe_getenv(kForwardedEnv[i]));
+    }
+    for(int i = 0; ok && i < argc; ++i) {
+        ok = write_string(fd, argv[i]);
+    }
+
+    uint32_t code = 0;
+    string out, err;
+    ok = ok && read_u32(fd, code) && read_string(fd, out) && read_string(fd, err);
+    ::close(fd);
+    if(!ok) {
+        return false;
+    }
+
+    cout << out << flush;
+    cerr << err << flush;
+    exit_code = static_cast<int>(code);
+    return true;
+}
+
+#else
+
+QueryServer::~QueryServer() {}
+void QueryServer::watch(const string& path) {}
+void QueryServer::drop_watches() {}
+void QueryServer::handle_client(int fd, const Handler& handler) {}
+
+int QueryServer::run(const Handler& handler, const function<void()>& on_invalidate)
+{
+    cerr << "--server is not supported on this platform" << endl;
+    return 1;
+}
+
+bool forward_query(const string& tool_name, int argc, char** argv, int& exit_code) { return false; }
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+
+/**
+ * @brief a long-lived query server (--server)
+ *
+ * The server keeps whatever the tool learned about the install tree (detected version, parsed build.cfg, libs map) in
+ * memory and answers queries sent over a Unix domain socket by `forward_query()`. Every file or directory the tool
+ * reads while answering a query should be registered with `server_watch()`: when any of them changes, the server
+ * calls the invalidate callback so the next query rebuilds the state from disk.
+ *
+ * The socket is $WXCONFIG_SOCKET when set, otherwise $XDG_RUNTIME_DIR/wx-config/<tool>.sock (falling back to
+ * /tmp/wx-config-<uid>/<tool>.sock). That directory must be ours with mode 0700 and the server must run as us, or the
+ * server refuses to start and the client evaluates in-process. Only available on Linux, elsewhere the tools always
+ * evaluate in-process
+ */
+class QueryServer
+{
+public:
+    /// run a query; output goes to cout/cerr, the return value is the exit code
+    typedef function<int(int argc, char** argv)> Handler;
+
+protected:
+    string m_tool_name;
+    int m_inotify_fd = -1;
+    unordered_map<int, string> m_watches;
+
+    void handle_client(int fd, const Handler& handler);
+    void drop_watches();
+
+public:
+    QueryServer(const string& tool_name)
+        : m_tool_name(tool_name)
+    {
+    }
+    ~QueryServer();
+
+    /**
+     * @brief serve queries until the process is killed. Return the process exit code on failure
+     */
+    int run(const Handler& handler, const function<void()>& on_invalidate);
+
+    /// watch `path` for changes (called via server_watch())
+    void watch(const string& path);
+};
+
+/**
+ * @brief when running as a server, invalidate the cached state once `path` changes. No-op otherwise
+ */
+void server_watch(const string& path);
+
+/**
+ * @brief try to answer this invocation using a running server
+ *
+ * On success, the server output is written to stdout/stderr, `exit_code` is set and true is returned. Return false
+ * if no server is reachable (or WXCONFIG_NO_SERVER is set) - the caller should then evaluate the query in-process
+ */
+bool forward_query(const string& tool_name, int argc, char** argv, int& exit_code);
+
+#endif // SERVER_HPP
@@ -0,0 +1,242 @@
+#include "shared_result_table.hpp"
+
+#include "utils.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+/// the layout of the segment, part of its name. Bump this when the table changes
+constexpr const char* kTableFormat = "t2";
+
+constexpr size_t kSlotCount = 256;
+/// a query is looked up in its home slot and the ones that follow it
+constexpr size_t kProbeLength = 8;
+constexpr size_t kWords = (SharedResultTable::kMaxOutput + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+/// a writer holding a slot for longer than this is assumed dead
+constexpr int64_t kStaleOwnerNs = 1000000000LL;
+
+/// the checksum of a slot content: a writer that lost the slot and kept storing into it leaves a mix no checksum matches
+uint64_t content_checksum(uint64_t key, uint64_t stamp, uint64_t length, const uint64_t* words, size_t count)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for(uint64_t value : { key, stamp, length }) {
+        hash = (hash ^ value) * 0x100000001b3ULL;
+    }
+    for(size_t i = 0; i < count; ++i) {
+        hash = (hash ^ words[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+int64_t now_ns()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static_assert(atomic<uint64_t>::is_always_lock_free && atomic<int64_t>::is_always_lock_free,
+    "the table is shared between processes, its atomics can not use locks");
+}
+
+/// the segment. All zeros (a new segment) is an empty table
+struct SharedResultTable::Table {
+    struct Slot {
+        atomic<int64_t> owner;        // when the current writer took the slot, 0 if none
+        atomic<uint64_t> sequence;    // odd while the slot is being written
+        atomic<uint64_t> key;         // 0 for a slot never written
+        atomic<uint64_t> stamp;
+        atomic<uint64_t> length;
+        atomic<int64_t> published_at; // to pick the oldest slot when the probe window is full
+        atomic<uint64_t> checksum;    // of key, stamp, length and the output words
+        // the output, copied word by word: a reader racing with a writer reads stale words, never undefined ones
+        atomic<uint64_t> words[kWords];
+    };
+    Slot slots[kSlotCount];
+};
+
+SharedResultTable::~SharedResultTable()
+{
+#ifndef _WIN32
+    if(m_table) {
+        ::munmap(m_table, sizeof(Table));
+    }
+#endif
+}
+
+namespace
+{
+string get_segment_name()
+{
+    string name = safe_getenv("WXCONFIG_SHM_NAME");
+    if(!name.empty()) {
+        return name.starts_with("/") ? name : "/" + name;
+    }
+#ifdef _WIN32
+    return "";
+#else
+    return "/wx-config-" + to_string(::getuid()) + "-" + kTableFormat;
+#endif
+}
+}
+
+SharedResultTable* SharedResultTable::get()
+{
+    static unique_ptr<SharedResultTable> instance = []() -> unique_ptr<SharedResultTable> {
+#ifdef _WIN32
+        return nullptr;
+#else
+        if(!safe_getenv("WXCONFIG_NO_SHM").empty()) {
+            return nullptr;
+        }
+        int fd = ::shm_open(get_segment_name().c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if(fd < 0) {
+            return nullptr;
+        }
+        // only ever share with ourselves, and only a table of the expected layout. A new segment is empty: size it,
+        // the pages read as zeros
+        struct stat st;
+        bool ok = ::fstat(fd, &st) == 0 && st.st_uid == ::getuid()
+                  && (st.st_size == sizeof(Table) || (st.st_size == 0 && ::ftruncate(fd, sizeof(Table)) == 0));
+        void* address = ok ? ::mmap(nullptr, sizeof(Table), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        ::close(fd);
+        if(address == MAP_FAILED) {
+            return nullptr;
+        }
+        unique_ptr<SharedResultTable> table(new SharedResultTable());
+        table->m_table = static_cast<Table*>(address);
+        return table;
+#endif
+    }();
+    return instance.get();
+}
+
+void SharedResultTable::remove()
+{
+#ifndef _WIN32
+    ::shm_unlink(get_segment_name().c_str());
+#endif
+}
+
+bool SharedResultTable::lookup(uint64_t key, uint64_t stamp, string& output) const
+{
+    key = key ? key : 1;
+    uint64_t words[kWords];
+    for(size_t probe = 0; probe < kProbeLength; ++probe) {
+        const Table::Slot& slot = m_table->slots[(key + probe) % kSlotCount];
+        // a few tries: a writer that got in meanwhile is done within microseconds
+        for(int attempt = 0; attempt < 4; ++attempt) {
+            uint64_t sequence = slot.sequence.load(memory_order_acquire);
+            if(sequence & 1) {
+                continue;
+            }
+            if(slot.key.load(memory_order_relaxed) != key) {
+                break;
+            }
+            uint64_t slot_stamp = slot.stamp.load(memory_order_relaxed);
+            size_t length = slot.length.load(memory_order_relaxed);
+            uint64_t checksum = slot.checksum.load(memory_order_relaxed);
+            if(length > kMaxOutput) {
+                continue;
+            }
+            size_t count = (length + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+            for(size_t i = 0; i < count; ++i) {
+                words[i] = slot.words[i].load(memory_order_relaxed);
+            }
+            atomic_thread_fence(memory_order_acquire);
+            if(slot.sequence.load(memory_order_relaxed) != sequence) {
+                continue;
+            }
+            // the sequence can not tell a late writer (one that was taken over while descheduled) storing into an even
+            // slot: the checksum does
+            if(content_checksum(key, slot_stamp, length, words, count) != checksum) {
+                continue;
+            }
+            // a consistent copy: the output of an older install is as good as none
+            if(slot_stamp != stamp) {
+                return false;
+            }
+            output.assign(reinterpret_cast<const char*>(words), length);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SharedResultTable::publish(uint64_t key, uint64_t stamp, string_view output)
+{
+    if(output.length() > kMaxOutput) {
+        return false;
+    }
+    key = key ? key : 1;
+
+    // the slot of this key if it has one, else an empty slot, else the oldest one
+    Table::Slot* slot = nullptr;
+    for(size_t probe = 0; probe < kProbeLength; ++probe) {
+        Table::Slot& candidate = m_table->slots[(key + probe) % kSlotCount];
+        uint64_t candidate_key = candidate.key.load(memory_order_relaxed);
+        if(candidate_key == key) {
+            slot = &candidate;
+            break;
+        }
+        if(candidate_key == 0) {
+            slot = slot && slot->key.load(memory_order_relaxed) == 0 ? slot : &candidate;
+        } else if(!slot
+                  || (slot->key.load(memory_order_relaxed) != 0
+                      && candidate.published_at.load(memory_order_relaxed)
+                             < slot->published_at.load(memory_order_relaxed))) {
+            slot = &candidate;
+        }
+    }
+
+    int64_t now = now_ns();
+    int64_t owner = slot->owner.load(memory_order_relaxed);
+    if(owner != 0 && now - owner < kStaleOwnerNs) {
+        return false;
+    }
+    if(!slot->owner.compare_exchange_strong(owner, now, memory_order_acquire)) {
+        return false;
+    }
+
+    // make the sequence odd. A writer taken over (dead, or only descheduled) may have left it odd: move it on by 2 so
+    // that writer, if it wakes up, fails to complete
+    uint64_t sequence = slot->sequence.load(memory_order_relaxed);
+    uint64_t odd_sequence = sequence + ((sequence & 1) ? 2 : 1);
+    if(!slot->sequence.compare_exchange_strong(sequence, odd_sequence, memory_order_relaxed)) {
+        return false;
+    }
+    atomic_thread_fence(memory_order_release);
+
+    uint64_t words[kWords];
+    size_t count = (output.length() + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    for(size_t i = 0; i < count; ++i) {
+        size_t offset = i * sizeof(uint64_t);
+        words[i] = 0;
+        memcpy(&words[i], output.data() + offset, min(sizeof(uint64_t), output.length() - offset));
+    }
+
+    slot->key.store(key, memory_order_relaxed);
+    slot->stamp.store(stamp, memory_order_relaxed);
+    slot->length.store(output.length(), memory_order_relaxed);
+    for(size_t i = 0; i < count; ++i) {
+        slot->words[i].store(words[i], memory_order_relaxed);
+    }
+    slot->published_at.store(now, memory_order_relaxed);
+    slot->checksum.store(content_checksum(key, stamp, output.length(), words, count), memory_order_relaxed);
+
+    // complete only if nobody took the slot over meanwhile, and never release the ownership of another writer
+    if(!slot->sequence.compare_exchange_strong(odd_sequence, odd_sequence + 1, memory_order_release)) {
+        return false;
+    }
+    slot->owner.compare_exchange_strong(now, 0, memory_order_release);
+    return true;
+}
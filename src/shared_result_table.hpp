@@ -0,0 +1,58 @@
+#ifndef SHARED_RESULT_TABLE_HPP
+#define SHARED_RESULT_TABLE_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+/**
+ * @brief the outputs of the latest queries, in a POSIX shared memory segment of the current user
+ *
+ * When `make -j64` starts dozens of identical queries at once, the first one to finish publishes its output here and
+ * the others read it from memory instead of opening the cache entry (or resolving the install again). The segment is
+ * a fixed, open addressed table: a query hashes to a home slot and is looked up in the few slots that follow it.
+ *
+ * Every slot is guarded by a sequence lock. Readers never block nor write: they copy the slot and retry when its
+ * sequence changed meanwhile (a writer got in). Writers make the sequence odd with a compare-and-swap, so two writers
+ * never share a slot; a writer that finds the slot taken gives up, the output is published by the other one anyway.
+ * A slot left odd by a writer that died is taken over after a second. The writer taken over may only have been
+ * descheduled: the takeover moves the sequence on so it can not complete, and a checksum of the slot content makes
+ * readers drop whatever it stores meanwhile.
+ *
+ * Linux and the other POSIX systems only: elsewhere get() returns null. WXCONFIG_NO_SHM=1 disables it,
+ * WXCONFIG_SHM_NAME overrides the name of the segment (/wx-config-<uid>-<format> by default)
+ */
+class SharedResultTable
+{
+    struct Table;
+    Table* m_table = nullptr;
+
+    SharedResultTable() = default;
+
+public:
+    /// the largest output a slot holds. Larger ones are not published
+    static constexpr size_t kMaxOutput = 4000;
+
+    ~SharedResultTable();
+    SharedResultTable(const SharedResultTable&) = delete;
+    SharedResultTable& operator=(const SharedResultTable&) = delete;
+
+    /// the table of this process, mapped on first use. Null when shared memory is not available or disabled
+    static SharedResultTable* get();
+
+    /// remove the segment (the mappings of running processes stay valid)
+    static void remove();
+
+    /**
+     * @brief the output published for `key` (a hash of the command line and the environment), if it was published for
+     * the same `stamp` (a hash of the input mtimes)
+     */
+    bool lookup(uint64_t key, uint64_t stamp, string& output) const;
+
+    /// publish `output`. False if it is too large or its slots are being written by other processes
+    bool publish(uint64_t key, uint64_t stamp, string_view output);
+};
+
+#endif // SHARED_RESULT_TABLE_HPP
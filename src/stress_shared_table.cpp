@@ -0,0 +1,235 @@
+#include "shared_result_table.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char** environ;
+
+// Stress test for the shared result table (POSIX only), not installed.
+//
+// Phase 1 forks --processes writers / readers that hammer a private table with --ops random lookups and publications
+// over more keys than the table has slots, so slots are taken over all the time. Every hit is compared with the output
+// expected for its key and stamp: a torn or mixed read is a failure.
+//
+// Phase 2 starts --invocations wx-config-msys2 processes, --jobs at a time, on a synthetic install with a handful of
+// distinct queries, and compares every output with the one computed without any cache.
+//
+// Usage: stress-shared-table [--processes=64] [--ops=20000] [--invocations=2000] [--jobs=128]
+// Exits with 1 on the first mismatch.
+
+using namespace std;
+
+namespace
+{
+struct Options {
+    size_t processes = 64;
+    size_t ops = 20000;
+    size_t invocations = 2000;
+    size_t jobs = 128;
+};
+
+constexpr uint64_t kKeyCount = 1024;
+
+/// what is published for `key` at `stamp`: its length and content both depend on them
+string expected_output(uint64_t key, uint64_t stamp)
+{
+    size_t length = 1 + (key * 7919 + stamp * 31) % SharedResultTable::kMaxOutput;
+    string output(length, ' ');
+    for(size_t i = 0; i < length; ++i) {
+        output[i] = static_cast<char>('!' + (key + stamp + i) % 90);
+    }
+    return output;
+}
+
+/// one forked worker: random lookups and publications. Return the number of inconsistent hits
+size_t hammer_table(size_t worker, size_t ops)
+{
+    SharedResultTable* table = SharedResultTable::get();
+    if(!table) {
+        return 1;
+    }
+    mt19937_64 rng(worker);
+    size_t errors = 0;
+    string output;
+    for(size_t i = 0; i < ops; ++i) {
+        uint64_t key = 1 + rng() % kKeyCount;
+        uint64_t stamp = rng() % 2;
+        if(rng() % 4 == 0) {
+            table->publish(key, stamp, expected_output(key, stamp));
+        } else if(table->lookup(key, stamp, output) && output != expected_output(key, stamp)) {
+            ++errors;
+        }
+    }
+    return errors;
+}
+
+bool run_table_phase(const Options& options)
+{
+    setenv("WXCONFIG_SHM_NAME", ("wx-config-stress-" + to_string(getpid())).c_str(), 1);
+    SharedResultTable::remove();
+
+    vector<pid_t> workers;
+    for(size_t worker = 0; worker < options.processes; ++worker) {
+        pid_t pid = fork();
+        if(pid == 0) {
+            _exit(hammer_table(worker, options.ops) == 0 ? 0 : 1);
+        }
+        workers.push_back(pid);
+    }
+    size_t failed = 0;
+    for(pid_t pid : workers) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        failed += !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    }
+    SharedResultTable::remove();
+    unsetenv("WXCONFIG_SHM_NAME");
+
+    cout << "{\"phase\":\"table\",\"processes\":" << options.processes << ",\"ops\":" << options.ops
+         << ",\"failed_processes\":" << failed << "}" << endl;
+    return failed == 0;
+}
+
+/// start `args` with its standard output written to `out_file`
+pid_t spawn(const vector<string>& args, const string& out_file)
+{
+    vector<char*> argv;
+    for(const auto& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 1, out_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    pid_t pid = -1;
+    if(posix_spawn(&pid, argv[0], &actions, nullptr, argv.data(), environ) != 0) {
+        pid = -1;
+    }
+    posix_spawn_file_actions_destroy(&actions);
+    return pid;
+}
+
+string read_file(const string& path)
+{
+    ifstream in_file(path, ios::binary);
+    stringstream content;
+    content << in_file.rdbuf();
+    return content.str();
+}
+
+bool run_invocation_phase(const Options& options)
+{
+    string root = (filesystem::temp_directory_path() / ("wx-config-stress-" + to_string(getpid()))).string();
+    filesystem::remove_all(root);
+    filesystem::create_directories(root + "/prefix/lib");
+    for(const char* lib : { "wx_baseu", "wx_baseu_net", "wx_baseu_xml", "wx_mswu_core", "wx_mswu_adv", "wx_mswu_aui",
+            "wx_mswu_html", "wx_mswu_stc", "wx_mswu_xrc", "wx_mswu_webview", "wx_mswu_qa" }) {
+        ofstream(root + "/prefix/lib/lib" + string(lib) + "-3.2.dll.a");
+    }
+    setenv("XDG_CACHE_HOME", (root + "/cache").c_str(), 1);
+    setenv("WXCONFIG_SHM_NAME", ("wx-config-stress-" + to_string(getpid())).c_str(), 1);
+    setenv("WXCONFIG_NO_SERVER", "1", 1);
+    SharedResultTable::remove();
+
+    string prefix_arg = "--prefix=" + root + "/prefix";
+    vector<vector<string>> queries = { { WX_CONFIG_MSYS2_EXE, prefix_arg, "--cflags" },
+        { WX_CONFIG_MSYS2_EXE, prefix_arg, "--libs" }, { WX_CONFIG_MSYS2_EXE, prefix_arg, "--libs", "all" },
+        { WX_CONFIG_MSYS2_EXE, prefix_arg, "--libs", "aui,stc" }, { WX_CONFIG_MSYS2_EXE, prefix_arg, "--rcflags" } };
+
+    // the reference outputs, without any cache
+    vector<string> expected;
+    setenv("WXCONFIG_NO_CACHE", "1", 1);
+    for(const auto& query : queries) {
+        string out_file = root + "/expected";
+        int status = 0;
+        waitpid(spawn(query, out_file), &status, 0);
+        expected.push_back(read_file(out_file));
+    }
+    unsetenv("WXCONFIG_NO_CACHE");
+
+    size_t mismatches = 0;
+    vector<pair<pid_t, size_t>> running; // pid, invocation
+    auto reap = [&]() {
+        int status = 0;
+        pid_t pid = wait(&status);
+        auto iter = find_if(running.begin(), running.end(), [pid](const auto& item) { return item.first == pid; });
+        if(iter == running.end()) {
+            return;
+        }
+        size_t invocation = iter->second;
+        running.erase(iter);
+        string out_file = root + "/out-" + to_string(invocation);
+        if(!WIFEXITED(status) || WEXITSTATUS(status) != 0
+           || read_file(out_file) != expected[invocation % queries.size()]) {
+            if(mismatches++ == 0) {
+                cerr << "invocation " << invocation << " printed: " << read_file(out_file) << endl;
+            }
+        }
+        filesystem::remove(out_file);
+    };
+    for(size_t invocation = 0; invocation < options.invocations; ++invocation) {
+        while(running.size() >= options.jobs) {
+            reap();
+        }
+        pid_t pid = spawn(queries[invocation % queries.size()], root + "/out-" + to_string(invocation));
+        if(pid < 0) {
+            cerr << "failed to start: " << WX_CONFIG_MSYS2_EXE << endl;
+            return false;
+        }
+        running.push_back({ pid, invocation });
+    }
+    while(!running.empty()) {
+        reap();
+    }
+
+    SharedResultTable::remove();
+    filesystem::remove_all(root);
+    cout << "{\"phase\":\"invocations\",\"invocations\":" << options.invocations << ",\"jobs\":" << options.jobs
+         << ",\"mismatches\":" << mismatches << "}" << endl;
+    return mismatches == 0;
+}
+
+Options parse_options(int argc, char** argv)
+{
+    Options options;
+    for(int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        string value = after_first(arg, "=");
+        if(arg.starts_with("--processes=")) {
+            options.processes = stoul(value);
+        } else if(arg.starts_with("--ops=")) {
+            options.ops = stoul(value);
+        } else if(arg.starts_with("--invocations=")) {
+            options.invocations = stoul(value);
+        } else if(arg.starts_with("--jobs=")) {
+            options.jobs = max<size_t>(1, stoul(value));
+        } else {
+            cerr << "usage: stress-shared-table [--processes=64] [--ops=20000] [--invocations=2000] [--jobs=128]"
+                 << endl;
+            exit(1);
+        }
+    }
+    return options;
+}
+}
+
+int main(int argc, char** argv)
+{
+    Options options = parse_options(argc, argv);
+    if(!run_table_phase(options) || !run_invocation_phase(options)) {
+        return 1;
+    }
+    return 0;
+}
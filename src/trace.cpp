@@ -0,0 +1,132 @@
+#include "trace.hpp"
+
+#include "utils.hpp"
+#include "wx_flags.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <process.h>
+#define wx_getpid _getpid
+#else
+#include <unistd.h>
+#define wx_getpid getpid
+#endif
+
+namespace
+{
+TraceSession* active_session = nullptr;
+bool atexit_registered = false;
+
+long long to_us(chrono::steady_clock::duration d) { return chrono::duration_cast<chrono::microseconds>(d).count(); }
+}
+
+/// exit() skips the destructors of the locals in main, make sure the trace line is still written
+void trace_flush_at_exit()
+{
+    if(active_session) {
+        active_session->flush(false);
+    }
+}
+
+TraceSession::TraceSession(const string& tool, int argc, char** argv)
+    : m_tool(tool)
+{
+    string path = safe_getenv("WXCONFIG_TRACE");
+    bool enabled = !path.empty();
+    for(int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if(arg.starts_with("--trace-timing")) {
+            enabled = true;
+            path = after_first(arg, "=");
+        }
+        m_args.push_back(arg);
+    }
+
+    if(!enabled) {
+        return;
+    }
+
+    m_enabled = true;
+    m_path = path;
+    m_start = chrono::steady_clock::now();
+    m_start_epoch_us =
+        chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count();
+
+    active_session = this;
+    if(!atexit_registered) {
+        atexit_registered = true;
+        atexit(trace_flush_at_exit);
+    }
+}
+
+TraceSession::~TraceSession()
+{
+    flush();
+    if(active_session == this) {
+        active_session = nullptr;
+    }
+}
+
+void TraceSession::flush(bool ok)
+{
+    if(!m_enabled || m_flushed) {
+        return;
+    }
+    m_flushed = true;
+
+    auto now = chrono::steady_clock::now();
+    long long pid = wx_getpid();
+
+    stringstream ss;
+    ss << "{\"tool\":\"" << json_escape(m_tool) << "\",\"pid\":" << pid << ",\"ts\":" << m_start_epoch_us
+       << ",\"dur\":" << to_us(now - m_start) << ",\"status\":\"" << (ok ? "ok" : "error") << "\",\"argv\":[";
+    for(size_t i = 0; i < m_args.size(); ++i) {
+        ss << (i == 0 ? "" : ",") << "\"" << json_escape(m_args[i]) << "\"";
+    }
+    ss << "],\"events\":[";
+    for(size_t i = 0; i < m_events.size(); ++i) {
+        const auto& event = m_events[i];
+        // a phase still running when exit() was called ends now
+        auto end = event.end == chrono::steady_clock::time_point() ? now : event.end;
+        ss << (i == 0 ? "" : ",") << "{\"name\":\"" << json_escape(event.name) << "\",\"ph\":\"X\",\"ts\":"
+           << (m_start_epoch_us + to_us(event.start - m_start)) << ",\"dur\":" << to_us(end - event.start)
+           << ",\"pid\":" << pid << ",\"tid\":0}";
+    }
+    ss << "]}\n";
+
+    string line = ss.str();
+    if(m_path.empty()) {
+        cerr << line << std::flush;
+        return;
+    }
+
+    // a single append-mode write per invocation, so lines from parallel jobs do not interleave
+    FILE* fp = fopen(m_path.c_str(), "ab");
+    if(!fp) {
+        return;
+    }
+    setvbuf(fp, nullptr, _IOFBF, line.length() + 1);
+    fwrite(line.data(), 1, line.length(), fp);
+    fclose(fp);
+}
+
+TraceScope::TraceScope(const char* name)
+{
+    if(!active_session || active_session->m_flushed) {
+        return;
+    }
+    m_session = active_session;
+    m_index = m_session->m_events.size();
+    m_session->m_events.push_back({ name, chrono::steady_clock::now(), {} });
+}
+
+TraceScope::~TraceScope()
+{
+    if(m_session) {
+        m_session->m_events[m_index].end = chrono::steady_clock::now();
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief opt-in per-phase timing of a single invocation
+ *
+ * Enabled with `--trace-timing[=<file>]` or the environment variable WXCONFIG_TRACE=<file>. When the invocation ends,
+ * one JSON line is appended to the file (stderr when no file is given):
+ *
+ * {"tool":"wx-config","pid":42,"ts":<epoch us>,"dur":<us>,"status":"ok","argv":[...],"events":[...]}
+ *
+ * Each entry in "events" is a Chrome trace-event "complete" event ({"name","ph":"X","ts","dur","pid","tid"}), so the
+ * lines of a whole `make -j` run can be merged into a single chrome://tracing document
+ */
+class TraceSession
+{
+    struct Event {
+        string name;
+        chrono::steady_clock::time_point start;
+        chrono::steady_clock::time_point end;
+    };
+
+    string m_tool;
+    string m_path;
+    vector<string> m_args;
+    vector<Event> m_events;
+    chrono::steady_clock::time_point m_start;
+    long long m_start_epoch_us = 0;
+    bool m_enabled = false;
+    bool m_flushed = false;
+
+    friend class TraceScope;
+    friend void trace_flush_at_exit();
+
+public:
+    TraceSession(const string& tool, int argc, char** argv);
+    ~TraceSession();
+
+    /// append the trace line. `ok` is false when the invocation terminated early (fatal error)
+    void flush(bool ok = true);
+    bool is_enabled() const { return m_enabled; }
+};
+
+/**
+ * @brief RAII timer for one phase of the active trace session. No-op when tracing is disabled
+ */
+class TraceScope
+{
+    TraceSession* m_session = nullptr;
+    size_t m_index = 0;
+
+public:
+    explicit TraceScope(const char* name);
+    ~TraceScope();
+};
+
+#endif // TRACE_HPP
@@ -1,5 +1,29 @@
 #include "utils.hpp"
 
+#include "lib_catalog.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+extern char** environ;
+#endif
+
+namespace
+{
+bool fatal_exit_throws = false;
+}
+
 string after_first(const string& str, const string& needle)
 {
     auto where = str.find(needle);
@@ -38,6 +62,232 @@ string safe_getenv(const string& name)
     return e;
 }
 
+bool has_arg(int argc, char** argv, const string& flag)
+{
+    for(int i = 1; i < argc; ++i) {
+        if(flag == argv[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool has_generator_arg(int argc, char** argv)
+{
+    for(int i = 1; i < argc; ++i) {
+        string_view arg = argv[i];
+        if(arg.starts_with("--manifest=") || arg.starts_with("--pch") || arg.starts_with("--response-file")
+           || arg.starts_with("--bake") || arg.starts_with("--header-units") || arg.starts_with("--profile")) {
+            return true;
+        }
+    }
+    return has_arg(argc, argv, "--cmake") || has_arg(argc, argv, "--pkg-config") || has_arg(argc, argv, "--make")
+           || has_arg(argc, argv, "--meson");
+}
+
+void fatal_exit(int code)
+{
+    if(fatal_exit_throws) {
+        throw FatalExit { code };
+    }
+    exit(code);
+}
+
+void set_fatal_exit_throws(bool b) { fatal_exit_throws = b; }
+
+uint64_t fnv1a_64(const string& str, uint64_t seed)
+{
+    uint64_t hash = seed;
+    for(unsigned char ch : str) {
+        hash ^= ch;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+string to_hex(uint64_t value)
+{
+    static const char digits[] = "0123456789abcdef";
+    string result(16, '0');
+    for(int i = 15; i >= 0; --i) {
+        result[i] = digits[value & 0xf];
+        value >>= 4;
+    }
+    return result;
+}
+
+bool write_file_if_changed(const string& path, const string& content)
+{
+    error_code ec;
+    if(filesystem::file_size(path, ec) == content.size() && !ec) {
+        ifstream in_file(path, ios::binary);
+        string current(content.size(), '\0');
+        if(in_file.read(current.data(), current.size()) && current == content) {
+            return true;
+        }
+    }
+
+    random_device rd;
+    string tmp_path = path + ".tmp." + to_hex((uint64_t(rd()) << 32) | rd());
+    {
+        ofstream out_file(tmp_path, ios::binary | ios::trunc);
+        out_file << content;
+        if(!out_file.good()) {
+            out_file.close();
+            filesystem::remove(tmp_path, ec);
+            return false;
+        }
+    }
+    filesystem::rename(tmp_path, path, ec);
+    if(ec) {
+        filesystem::remove(tmp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+void parallel_for(size_t count, const function<void(size_t)>& func)
+{
+    size_t threads_count = min<size_t>(count, max(1u, thread::hardware_concurrency()));
+    if(threads_count <= 1) {
+        for(size_t i = 0; i < count; ++i) {
+            func(i);
+        }
+        return;
+    }
+
+    // each worker takes the next index until none is left
+    atomic_size_t next { 0 };
+    auto worker = [&]() {
+        for(size_t i = next++; i < count; i = next++) {
+            func(i);
+        }
+    };
+
+    vector<thread> threads;
+    threads.reserve(threads_count - 1);
+    for(size_t i = 1; i < threads_count; ++i) {
+        threads.emplace_back(worker);
+    }
+    // the calling thread is part of the pool
+    worker();
+    for(auto& t : threads) {
+        t.join();
+    }
+}
+
+string find_program(const string& name)
+{
+    error_code ec;
+    if(name.find_first_of("/\\") != string::npos) {
+        return filesystem::is_regular_file(name, ec) ? name : "";
+    }
+
+#ifdef _WIN32
+    constexpr char path_sep = ';';
+    string file_name = filesystem::path(name).has_extension() ? name : name + ".exe";
+#else
+    constexpr char path_sep = ':';
+    const string& file_name = name;
+#endif
+
+    string path_env = safe_getenv("PATH");
+    size_t start = 0;
+    while(start <= path_env.length()) {
+        size_t end = path_env.find(path_sep, start);
+        if(end == string::npos) {
+            end = path_env.length();
+        }
+        string dir = path_env.substr(start, end - start);
+        start = end + 1;
+        if(dir.empty()) {
+            continue;
+        }
+        string candidate = dir + DIR_SEP + file_name;
+        if(filesystem::is_regular_file(candidate, ec)) {
+            return candidate;
+        }
+    }
+    return "";
+}
+
+int run_command(const vector<string>& args, bool quiet)
+{
+    if(args.empty()) {
+        return -1;
+    }
+
+#ifdef _WIN32
+    // the arguments are joined into a single command line by the CRT, quote the ones that need it
+    vector<string> quoted;
+    for(const auto& arg : args) {
+        if(!arg.empty() && arg.find_first_of(" \t\"") == string::npos) {
+            quoted.push_back(arg);
+            continue;
+        }
+        string q = "\"";
+        for(char ch : arg) {
+            if(ch == '"') {
+                q += '\\';
+            }
+            q += ch;
+        }
+        q += "\"";
+        quoted.push_back(q);
+    }
+    vector<const char*> argv;
+    for(const auto& arg : quoted) {
+        argv.push_back(arg.c_str());
+    }
+    argv.push_back(nullptr);
+
+    // the child inherits our stdout / stderr: point them at NUL for the duration of the call
+    int saved_out = -1, saved_err = -1;
+    if(quiet) {
+        int null_fd = _open("NUL", _O_WRONLY);
+        if(null_fd >= 0) {
+            saved_out = _dup(1);
+            saved_err = _dup(2);
+            _dup2(null_fd, 1);
+            _dup2(null_fd, 2);
+            _close(null_fd);
+        }
+    }
+    intptr_t rc = _spawnvp(_P_WAIT, args[0].c_str(), argv.data());
+    if(saved_out >= 0) {
+        _dup2(saved_out, 1);
+        _dup2(saved_err, 2);
+        _close(saved_out);
+        _close(saved_err);
+    }
+    return rc < 0 ? -1 : static_cast<int>(rc);
+#else
+    vector<char*> argv;
+    for(const auto& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if(quiet) {
+        posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+        posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY, 0);
+    }
+    pid_t pid = 0;
+    int spawn_rc = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if(spawn_rc != 0) {
+        return -1;
+    }
+    int status = 0;
+    if(waitpid(pid, &status, 0) < 0) {
+        return -1;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+#endif
+}
+
 /// CommandLineParser
 void CommandLineParser::parse_args(bool require_wxcfg)
 {
@@ -48,16 +298,18 @@ void CommandLineParser::parse_args(bool require_wxcfg)
             set_prefix(after_first(arg, "="));
             if(m_prefix.empty()) {
                 print_usage();
-                exit(1);
+                fatal_exit(1);
             }
         } else if(arg.starts_with("--wxcfg")) {
             set_config(after_first(arg, "="));
             if(m_config.empty()) {
                 print_usage();
-                exit(2);
+                fatal_exit(2);
             }
         } else if(arg.starts_with("--libs")) {
-            if((i + 1) < m_argc) {
+            if(after_first(arg, "=") == "auto") {
+                parse_libs("auto");
+            } else if((i + 1) < m_argc) {
                 string arg = m_argv[i + 1];
                 // ignore the next arg if it starts with `--`
                 if(!arg.starts_with("--")) {
@@ -78,23 +330,109 @@ void CommandLineParser::parse_args(bool require_wxcfg)
             set_is_debug();
         } else if(arg.starts_with("--cmake")) {
             set_is_cmake();
+        } else if(arg.starts_with("--no-cache")) {
+            set_no_cache();
+        } else if(arg.starts_with("--json") || arg.starts_with("--all")) {
+            set_is_json();
+        } else if(arg.starts_with("--pkg-config")) {
+            set_is_pkg_config();
+        } else if(arg.starts_with("--make")) {
+            set_is_make();
+        } else if(arg.starts_with("--meson")) {
+            set_is_meson();
+        } else if(arg.starts_with("--list-configs")) {
+            set_is_list_configs();
+        } else if(arg.starts_with("--manifest")) {
+            set_is_manifest();
+            m_manifest_file = after_first(arg, "=");
+        } else if(arg.starts_with("--pch")) {
+            set_is_pch();
+            m_pch_compiler = after_first(arg, "=");
+        } else if(arg.starts_with("--header-units")) {
+            set_is_header_units();
+            m_header_units_compiler = after_first(arg, "=");
+        } else if(arg.starts_with("--canonical")) {
+            set_is_canonical();
+        } else if(arg.starts_with("--response-file")) {
+            set_is_response_file();
+            m_response_file_dir = after_first(arg, "=");
+        } else if(arg.starts_with("--absolute")) {
+            set_is_absolute();
+            string policy = after_first(arg, "=");
+            if(policy == "static") {
+                set_prefer_static();
+            } else if(!policy.empty() && policy != "import") {
+                cerr << "unknown --absolute policy: " << policy << " (expected import or static)" << endl;
+                print_usage();
+                fatal_exit(1);
+            }
+        } else if(arg.starts_with("--remap-prefix")) {
+            set_is_remap_prefix();
+            m_prefix_alias = after_first(arg, "=");
+        } else if(arg.starts_with("--bake")) {
+            set_is_bake();
+            m_bake_file = after_first(arg, "=");
+            if(m_bake_file.empty()) {
+                print_usage();
+                fatal_exit(1);
+            }
+        } else if(arg.starts_with("--profile")) {
+            if(!parse_build_profile(after_first(arg, "="), m_profile)) {
+                cerr << "unknown --profile: " << after_first(arg, "=") << " (expected fastlink, lto or fastdebug)"
+                     << endl;
+                print_usage();
+                fatal_exit(1);
+            }
+        } else if(arg.starts_with("--depfile")) {
+            m_depfile = after_first(arg, "=");
+            if(m_depfile.empty()) {
+                print_usage();
+                fatal_exit(1);
+            }
+        } else if(arg.starts_with("--objects")) {
+            auto objects = split_by_comma(after_first(arg, "="));
+            m_objects.insert(m_objects.end(), objects.begin(), objects.end());
         }
     }
 
+    if(is_auto_libs() && m_objects.empty()) {
+        cerr << "--libs=auto requires the object files of the target: --objects=<file>[,<file>...]" << endl;
+        print_usage();
+        fatal_exit(1);
+    }
+
+    if(!m_depfile.empty() && !is_generate_files()) {
+        cerr << "--depfile requires a generated file: --cmake, --pkg-config, --make or --meson" << endl;
+        print_usage();
+        fatal_exit(1);
+    }
+
+    // --json and the generated build files report the libraries too, use the default set unless --libs was passed.
+    // --header-units picks the headers of the libraries
+    if((is_json() || is_manifest() || is_create_pkg_config_file() || is_create_make_file() || is_create_meson_file()
+           || is_header_units())
+       && m_libs.empty()) {
+        parse_libs("std");
+    }
+
     if(m_prefix.empty()) {
         m_prefix = safe_getenv("WXWIN");
+        if(m_prefix.empty() && m_discover_prefix) {
+            m_prefix = m_discover_prefix();
+        }
         if(m_prefix.empty()) {
             cerr << "Missing prefix. Please use environment variable WXWIN or --prefix=..." << endl;
             print_usage();
-            exit(3);
+            fatal_exit(3);
         }
     }
-    if(require_wxcfg && m_config.empty()) {
+    // --list-configs and --manifest cover every config under the prefix
+    if(require_wxcfg && m_config.empty() && !is_list_configs() && !is_manifest()) {
         m_config = safe_getenv("WXCFG");
         if(m_config.empty()) {
             cerr << "Missing config. Please use environment variable WXCFG or --wxcfg=..." << endl;
             print_usage();
-            exit(4);
+            fatal_exit(4);
         }
     }
 }
@@ -112,6 +450,52 @@ void CommandLineParser::print_usage()
             "[...]] [--debug]"
          << endl;
     cout << "wx-config --cmake [--prefix=<install_dir>] [--wxcfg=config-dir]" << endl;
+    cout << "Results are cached under $XDG_CACHE_HOME/wx-config. Pass --no-cache (or set WXCONFIG_NO_CACHE=1) to "
+            "bypass the cache"
+         << endl;
+    cout << "On POSIX systems (not on Windows) they are also shared in memory between concurrent invocations. Set "
+            "WXCONFIG_NO_SHM=1 to skip the shared memory table"
+         << endl;
+    cout << "wx-config --json [--libs ...]: print the compile, resource and link flags as a single JSON document" << endl;
+    cout << "wx-config [--pkg-config] [--make] [--meson] [--libs ...]: generate wx.pc, wx.mk and/or wx-meson.ini in "
+            "the current directory"
+         << endl;
+    cout << "Pass --absolute[=import|static] with --libs to link the full path of each library (import libraries "
+            "first by default) instead of -L / -l"
+         << endl;
+    cout << "Pass --remap-prefix[=<alias>] to pass the include dirs relative to the prefix and map the prefix to <alias> "
+            "(default: WXCONFIG_PREFIX_MAP, else /wx) in the objects, so they are identical on every machine"
+         << endl;
+    cout << "Pass --profile=fastlink|lto|fastdebug to add the compile and link flags of that kind of build, as far as "
+            "the compiler supports them. --debug does not change the output"
+         << endl;
+    cout << "Pass --depfile=<path> along with the options above to write a Make / Ninja depfile listing the inputs of "
+            "the generated files"
+         << endl;
+    cout << "Pass --trace-timing[=<file>] (or set WXCONFIG_TRACE=<file>) to append the timing of each phase as JSON"
+         << endl;
+    cout << "wx-config --libs=auto --objects=<file>[,<file>...]: only link the wx libraries used by the given object "
+            "files or archives"
+         << endl;
+    cout << "wx-config --list-configs | --manifest[=<file>] [--libs ...]: list every config under <prefix>/lib, or "
+            "print the flags of all of them as a single JSON document"
+         << endl;
+    cout << "wx-config --pch[=<compiler>]: precompile <wx/wx.h> with the --cflags (cached) and print the -include "
+            "flags that use it"
+         << endl;
+    cout << "wx-config --header-units[=<compiler>] [--libs ...]: build the C++20 header units of the main headers of "
+            "the libraries (<wx/wx.h>, <wx/aui/aui.h>...) with the --cflags (cached) and print the flags that import "
+            "them"
+         << endl;
+    cout << "Pass --canonical to normalize the paths and the flag order, and --response-file[=<dir>] to print a "
+            "single @<file> argument named after the hash of the (canonical) flags"
+         << endl;
+    cout << "wx-config --bake=<out> [...]: generate (and compile, unless <out> ends with .cpp) a program answering "
+            "--cflags, --rcflags, --libs and --cmake for this install from baked tables"
+         << endl;
+    cout << "wx-config --server: keep the install state in memory and answer queries from other invocations (Linux "
+            "only)"
+         << endl;
     cout << "Example usage:" << endl;
     cout << endl;
     cout << "To print the default list of link flags + libraries:" << endl;
@@ -128,60 +512,36 @@ void CommandLineParser::print_usage()
 void CommandLineParser::parse_libs(const string& libs)
 {
     auto vlibs = split_by_comma(libs);
-    if(vlibs.empty()) {
-        vlibs.push_back("std");
-    }
-
-    // --libs std
-    // -lwx_mswu_xrc-3.0 -lwx_mswu_webview-3.0 -lwx_mswu_html-3.0 -lwx_mswu_qa-3.0 -lwx_mswu_adv-3.0 -lwx_mswu_core-3.0
-    // -lwx_baseu_xml-3.0 -lwx_baseu_net-3.0 -lwx_baseu-3.0
-    auto default_libs = { "xrc", "webview", "html", "qa", "adv", "core", "xml", "net", "base" };
-
-    // --libs all
-    // -lwx_mswu_xrc-3.0 -lwx_mswu_webview-3.0 -lwx_mswu_stc-3.0 -lwx_mswu_richtext-3.0 -lwx_mswu_ribbon-3.0
-    // -lwx_mswu_propgrid-3.0 -lwx_mswu_aui-3.0 -lwx_mswu_gl-3.0 -lwx_mswu_html-3.0 -lwx_mswu_qa-3.0 -lwx_mswu_adv-3.0
-    // -lwx_mswu_core-3.0 -lwx_baseu_xml-3.0 -lwx_baseu_net-3.0 -lwx_baseu-3.0
-    auto all_libs = {
-        "xrc",
-        "webview",
-        "stc",
-        "richtext",
-        "ribbon",
-        "propgrid",
-        "aui",
-        "gl",
-        "html",
-        "qa",
-        "adv",
-        "core",
-        "xml",
-        "net",
-        "base",
-        "media",
-    };
 
-    // construct a map from the "all" list
-    unordered_set<string> S { all_libs.begin(), all_libs.end() };
-
-    // always make sure that "base" is included
-    auto has_base = find_if(
-        vlibs.begin(), vlibs.end(), [](const string& lib) { return lib == "base" || lib == "all" || lib == "std"; });
-    if(has_base == vlibs.end()) {
-        vlibs.push_back("base");
-    }
-
-    for(const auto& lib : vlibs) {
-        // handle special cases
-        if(lib == "std") {
-            m_libs.insert(m_libs.end(), default_libs.begin(), default_libs.end());
-        } else if(lib == "all") {
-            m_libs.reserve(all_libs.size());
-            m_libs.insert(m_libs.end(), all_libs.begin(), all_libs.end());
-        } else {
-            // search by name
-            if(S.contains(lib)) {
-                m_libs.emplace_back(lib);
-            }
+    // --libs auto: the libs are picked later from the object files, anything else listed is linked in any case
+    auto auto_iter = find(vlibs.begin(), vlibs.end(), "auto");
+    if(auto_iter != vlibs.end()) {
+        set_is_auto_libs();
+        vlibs.erase(auto_iter);
+        if(vlibs.empty()) {
+            vlibs.push_back("base");
         }
     }
+
+    auto expanded = expand_libs(vlibs);
+    m_libs.insert(m_libs.end(), expanded.begin(), expanded.end());
+}
+
+vector<string> expand_libs(const vector<string>& names)
+{
+    // "base" is always linked, an empty list means "std"
+    LibSet libs = names.empty() ? kStdLibs : lib_bit(kLibBase);
+    for(const auto& name : names) {
+        if(name == "std") {
+            libs |= kStdLibs;
+        } else if(name == "all") {
+            libs |= kAllLibs;
+        } else if(int index = find_wx_lib(name); index >= 0) {
+            libs |= LibSet(1) << index;
+        }
+    }
+
+    vector<string> result;
+    for_each_lib(close_lib_set(libs), [&result](const WxLibInfo& lib) { result.emplace_back(lib.name); });
+    return result;
 }
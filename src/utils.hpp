@@ -1,10 +1,16 @@
 #ifndef UTILS_HPP
 #define UTILS_HPP
 
+#include "build_profile.hpp"
+#include "wx_version.hpp"
+
 #include <algorithm>
+#include <cstdint>
+#include <functional>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -16,6 +22,63 @@ string before_first(const string& str, const string& needle);
 void trim(string& str, bool from_right = true, const string& trim_chars = "\r\n\t\v ");
 string safe_getenv(const string& name);
 
+/// return true if `flag` appears in the command line (used before the full parse_args() runs)
+bool has_arg(int argc, char** argv, const string& flag);
+
+/**
+ * @brief return true if the command line asks for a file to be generated (--cmake, --manifest=<file>, --pch,
+ * --response-file...) or for a --profile, which picks the compiler from CXX / PATH: the query server sees neither the
+ * working directory files nor that environment, these always run in-process
+ */
+bool has_generator_arg(int argc, char** argv);
+
+/**
+ * @brief thrown by fatal_exit() instead of terminating the process when set_fatal_exit_throws(true) was called
+ */
+struct FatalExit {
+    int code = 0;
+};
+
+/**
+ * @brief terminate the current query with `code`. In a long-lived process (--server) this throws FatalExit so a bad
+ * query does not bring down the server
+ */
+[[noreturn]] void fatal_exit(int code);
+void set_fatal_exit_throws(bool b);
+
+/// 64 bit FNV-1a hash, stable across runs and platforms (unlike std::hash)
+uint64_t fnv1a_64(const string& str, uint64_t seed = 0xcbf29ce484222325ULL);
+/// return the 16 chars, zero padded, hex representation of `value`
+string to_hex(uint64_t value);
+
+/**
+ * @brief expand a --libs list ("std", "all" or lib names such as "core") into the wx lib names, with all their
+ * dependencies, in link order. "base" is always added and unknown names are dropped. An empty list means "std"
+ */
+vector<string> expand_libs(const vector<string>& names);
+
+/**
+ * @brief replace the content of `path` with `content` through a temporary file + rename, so readers (and concurrent
+ * writers) never see a partial file. Nothing is written when the file already holds `content`, which keeps its mtime
+ * and does not trigger the tools watching it. Return false if the file could not be written
+ */
+bool write_file_if_changed(const string& path, const string& content);
+
+/**
+ * @brief call `func(i)` for every i in [0, count) on a pool of up to hardware_concurrency() threads. Return once all the
+ * calls are done. `func` must be safe to call concurrently for different indexes
+ */
+void parallel_for(size_t count, const function<void(size_t)>& func);
+
+/// the full path of the program `name`, searched in PATH (unless `name` already has a directory). Empty if not found
+string find_program(const string& name);
+
+/**
+ * @brief run `args` (args[0] is searched in PATH) with the standard streams of this process and wait for it. Return
+ * its exit code, or -1 if it could not be started. With `quiet`, its standard output and error are discarded
+ */
+int run_command(const vector<string>& args, bool quiet = false);
+
 #define DIR_SEP '/'
 #define DIR_SEP_STR "/"
 
@@ -29,6 +92,16 @@ protected:
     string m_mode;   // --libs | --cflags
     string m_prefix; // --prefix or the value from WXWIN
     string m_config; // --config or the value read from WXCFG
+    vector<string> m_objects;   // --objects, the input of --libs=auto
+    string m_manifest_file;     // --manifest=<file>, empty for stdout
+    string m_pch_compiler;      // --pch=<compiler>, empty for the default one
+    string m_header_units_compiler; // --header-units=<compiler>, empty for the default one
+    string m_response_file_dir; // --response-file=<dir>, empty for the cache dir
+    string m_depfile;           // --depfile=<path>, the dependencies of the generated files
+    string m_prefix_alias;      // --remap-prefix=<alias>, empty for the configured one
+    string m_bake_file;         // --bake=<out>, the generated program (or its source)
+    function<string()> m_discover_prefix; // the prefix to use when neither --prefix nor WXWIN is given
+    BuildProfile m_profile = BuildProfile::kNone; // --profile=<name>
     size_t m_flags = 0;
 
 protected:
@@ -37,12 +110,37 @@ protected:
         kIsCxxFlags = (1 << 1),
         kIsDebug = (1 << 2),
         kCMakeIncludeFile = (1 << 3),
+        kNoCache = (1 << 4),
+        kJson = (1 << 5),
+        kPkgConfigFile = (1 << 6),
+        kMakeFile = (1 << 7),
+        kMesonFile = (1 << 8),
+        kAutoLibs = (1 << 9),
+        kListConfigs = (1 << 10),
+        kManifest = (1 << 11),
+        kPch = (1 << 12),
+        kCanonical = (1 << 13),
+        kResponseFile = (1 << 14),
+        kAbsolute = (1 << 15),
+        kPreferStatic = (1 << 16),
+        kRemapPrefix = (1 << 17),
+        kBake = (1 << 18),
+        kHeaderUnits = (1 << 19),
     };
 
 protected:
     void reset()
     {
         m_libs.clear();
+        m_objects.clear();
+        m_manifest_file.clear();
+        m_pch_compiler.clear();
+        m_header_units_compiler.clear();
+        m_response_file_dir.clear();
+        m_depfile.clear();
+        m_prefix_alias.clear();
+        m_bake_file.clear();
+        m_profile = BuildProfile::kNone;
         m_mode.clear();
         m_prefix.clear();
         m_flags = 0;
@@ -59,6 +157,22 @@ protected:
     void set_is_rcflags() { m_flags |= kIsRcFlags; }
     void set_is_debug() { m_flags |= kIsDebug; }
     void set_is_cmake() { m_flags |= kCMakeIncludeFile; }
+    void set_no_cache() { m_flags |= kNoCache; }
+    void set_is_json() { m_flags |= kJson; }
+    void set_is_pkg_config() { m_flags |= kPkgConfigFile; }
+    void set_is_make() { m_flags |= kMakeFile; }
+    void set_is_meson() { m_flags |= kMesonFile; }
+    void set_is_auto_libs() { m_flags |= kAutoLibs; }
+    void set_is_list_configs() { m_flags |= kListConfigs; }
+    void set_is_manifest() { m_flags |= kManifest; }
+    void set_is_pch() { m_flags |= kPch; }
+    void set_is_canonical() { m_flags |= kCanonical; }
+    void set_is_response_file() { m_flags |= kResponseFile; }
+    void set_is_absolute() { m_flags |= kAbsolute; }
+    void set_prefer_static() { m_flags |= kPreferStatic; }
+    void set_is_remap_prefix() { m_flags |= kRemapPrefix; }
+    void set_is_bake() { m_flags |= kBake; }
+    void set_is_header_units() { m_flags |= kHeaderUnits; }
 
     /**
      * @brief split input string by command and return vector of the results
@@ -88,13 +202,52 @@ public:
     void parse_args(bool require_wxcfg = false);
     void print_usage();
 
+    /// find the prefix by other means when neither --prefix nor WXWIN is given. `discover` returns empty on failure
+    void set_prefix_discovery(const function<string()>& discover) { m_discover_prefix = discover; }
+
     const auto& get_libs() const { return m_libs; }
+    const auto& get_objects() const { return m_objects; }
+    /// replace the libs list (used by --libs=auto once the object files were scanned)
+    void set_libs(const vector<string>& libs) { m_libs = libs; }
     const auto& get_prefix() const { return m_prefix; }
     const auto& get_config() const { return m_config; }
+    const auto& get_manifest_file() const { return m_manifest_file; }
+    const auto& get_pch_compiler() const { return m_pch_compiler; }
+    const auto& get_header_units_compiler() const { return m_header_units_compiler; }
+    const auto& get_response_file_dir() const { return m_response_file_dir; }
+    const auto& get_depfile() const { return m_depfile; }
+    const auto& get_prefix_alias() const { return m_prefix_alias; }
+    const auto& get_bake_file() const { return m_bake_file; }
+    int get_argc() const { return m_argc; }
+    char** get_argv() const { return m_argv; }
+    BuildProfile get_profile() const { return m_profile; }
     bool is_rcflags_set() const { return m_flags & kIsRcFlags; }
     bool is_cxxflags_set() const { return m_flags & kIsCxxFlags; }
     bool is_debug() const { return m_flags & kIsDebug; }
     bool is_create_cmake_file() const { return m_flags & kCMakeIncludeFile; }
+    bool is_no_cache() const { return m_flags & kNoCache; }
+    bool is_json() const { return m_flags & kJson; }
+    bool is_create_pkg_config_file() const { return m_flags & kPkgConfigFile; }
+    bool is_create_make_file() const { return m_flags & kMakeFile; }
+    bool is_create_meson_file() const { return m_flags & kMesonFile; }
+    bool is_auto_libs() const { return m_flags & kAutoLibs; }
+    bool is_list_configs() const { return m_flags & kListConfigs; }
+    bool is_manifest() const { return m_flags & kManifest; }
+    bool is_pch() const { return m_flags & kPch; }
+    /// --response-file implies --canonical, so equivalent flags map to the same file
+    bool is_canonical() const { return m_flags & (kCanonical | kResponseFile); }
+    bool is_response_file() const { return m_flags & kResponseFile; }
+    bool is_absolute() const { return m_flags & kAbsolute; }
+    /// --absolute=static: link lib<name>.a rather than lib<name>.dll.a when both are installed
+    bool is_prefer_static() const { return m_flags & kPreferStatic; }
+    bool is_remap_prefix() const { return m_flags & kRemapPrefix; }
+    bool is_bake() const { return m_flags & kBake; }
+    bool is_header_units() const { return m_flags & kHeaderUnits; }
+    /// true when this invocation writes files into the working directory
+    bool is_generate_files() const
+    {
+        return m_flags & (kCMakeIncludeFile | kPkgConfigFile | kMakeFile | kMesonFile);
+    }
 
     bool contains_lib(const string& lib) const
     {
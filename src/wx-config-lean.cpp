@@ -0,0 +1,589 @@
+#include "build_cfg.hpp"
+#include "flag_catalog.hpp"
+#include "lib_catalog.hpp"
+#include "wx_version.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <io.h>
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// wx-config-lean / wx-config-msys2-lean: the common queries (--cflags, --cxxflags, --rcflags and --libs [<list>])
+// with a startup cost close to the one of `true`.
+//
+// Everything else the full tools do (the result cache, the query server, the generators, --json...) costs a process
+// start with iostream, locale and filesystem initialization. Here the install is read with raw syscalls, the output
+// is assembled in a fixed buffer and printed with a single write(2), and nothing needs the C++ runtime, so the binary
+// does not even load it. Any other query, and every error, is handed over to the full tool (the sibling executable
+// without the -lean suffix) so the behavior and the messages are the same. The output is byte identical.
+//
+// Built twice: WX_CONFIG_LEAN_MSYS2=1 for wx-config-msys2-lean, 0 for wx-config-lean
+
+using namespace std;
+
+namespace
+{
+#if WX_CONFIG_LEAN_MSYS2
+constexpr string_view kFullTool = "wx-config-msys2";
+#else
+constexpr string_view kFullTool = "wx-config";
+#endif
+
+/// the options handled by the full tool only (see CommandLineParser::parse_args())
+constexpr string_view kFullToolOptions[] = { "--cmake", "--json", "--all", "--pkg-config", "--make", "--meson",
+    "--list-configs", "--manifest", "--pch", "--canonical", "--response-file", "--absolute", "--depfile", "--objects",
+    "--trace-timing", "--server", "--profile", "--remap-prefix", "--bake", "--header-units" };
+
+/// a string of at most `N - 1` chars, assembled in place. Appending past the end sets the overflow bit
+template <size_t N> class FixedString
+{
+    char m_data[N];
+    size_t m_length = 0;
+    bool m_overflow = false;
+
+public:
+    FixedString() { m_data[0] = 0; }
+
+    FixedString& operator<<(string_view str)
+    {
+        if(m_length + str.length() >= N) {
+            m_overflow = true;
+            return *this;
+        }
+        memcpy(m_data + m_length, str.data(), str.length());
+        m_length += str.length();
+        m_data[m_length] = 0;
+        return *this;
+    }
+
+    string_view view() const { return { m_data, m_length }; }
+    const char* c_str() const { return m_data; }
+    char* data() { return m_data; }
+    bool overflow() const { return m_overflow; }
+    void truncate(size_t length)
+    {
+        if(length < m_length) {
+            m_length = length;
+            m_data[m_length] = 0;
+        }
+    }
+};
+
+using Path = FixedString<4096>;
+using Output = FixedString<65536>;
+
+/// "<option><item> " for every item, as format_cflags() and friends join the lists
+template <size_t N> void append_list(Output& out, string_view option, const string_view (&items)[N])
+{
+    for(string_view item : items) {
+        out << option << item << " ";
+    }
+}
+
+/// what the full parser would collect for the options handled here
+struct Query {
+    Path prefix;
+    Path config;
+    // the libs of every --libs option, in command line order
+    LibSet lib_lists[16];
+    size_t lib_list_count = 0;
+    bool cxxflags = false;
+    bool rcflags = false;
+};
+
+/// str[pos, pos + count), clamped. Unlike string_view::substr() it can not throw, which would need the C++ runtime
+constexpr string_view slice(string_view str, size_t pos, size_t count = string_view::npos)
+{
+    pos = pos < str.length() ? pos : str.length();
+    return string_view(str.data() + pos, count < str.length() - pos ? count : str.length() - pos);
+}
+
+constexpr bool has_prefix(string_view str, string_view prefix) { return slice(str, 0, prefix.length()) == prefix; }
+
+string_view get_env(const char* name)
+{
+    const char* value = ::getenv(name);
+    return value ? value : "";
+}
+
+string_view after_first(string_view str, string_view needle)
+{
+    size_t where = str.find(needle);
+    return where == string_view::npos ? string_view() : slice(str, where + needle.length());
+}
+
+/// same as CommandLineParser::parse_libs() + expand_libs(). False for --libs auto
+bool parse_libs(string_view list, Query& query)
+{
+    if(query.lib_list_count == sizeof(query.lib_lists) / sizeof(query.lib_lists[0])) {
+        return false;
+    }
+
+    bool empty = true;
+    LibSet libs = lib_bit(kLibBase);
+    while(true) {
+        size_t comma = list.find(',');
+        string_view name = slice(list, 0, comma);
+        // split_by_comma() only trims from the right
+        size_t last = name.find_last_not_of(" \n\r\t");
+        name = last == string_view::npos ? string_view() : slice(name, 0, last + 1);
+        if(name == "auto") {
+            return false;
+        }
+        if(!name.empty()) {
+            empty = false;
+            if(name == "std") {
+                libs |= kStdLibs;
+            } else if(name == "all") {
+                libs |= kAllLibs;
+            } else if(int index = find_wx_lib(name); index >= 0) {
+                libs |= LibSet(1) << index;
+            }
+        }
+        if(comma == string_view::npos) {
+            break;
+        }
+        list = slice(list, comma + 1);
+    }
+    query.lib_lists[query.lib_list_count++] = close_lib_set(empty ? kStdLibs : libs);
+    return true;
+}
+
+/// fill `query` from the command line and the environment. False if the full tool has to answer
+bool parse_query(int argc, char** argv, Query& query)
+{
+    if(!get_env("WXCONFIG_TRACE").empty()) {
+        return false;
+    }
+
+    string_view prefix, config;
+    for(int i = 1; i < argc; ++i) {
+        string_view arg = argv[i];
+        for(string_view option : kFullToolOptions) {
+            if(has_prefix(arg, option)) {
+                return false;
+            }
+        }
+
+        if(has_prefix(arg, "--prefix")) {
+            prefix = after_first(arg, "=");
+            if(prefix.empty()) {
+                return false;
+            }
+        } else if(has_prefix(arg, "--wxcfg")) {
+            config = after_first(arg, "=");
+            if(config.empty()) {
+                return false;
+            }
+        } else if(has_prefix(arg, "--libs")) {
+            if(after_first(arg, "=") == "auto") {
+                return false;
+            }
+            string_view list = "std";
+            if(i + 1 < argc && !has_prefix(argv[i + 1], "--")) {
+                list = argv[++i];
+            }
+            if(!parse_libs(list, query)) {
+                return false;
+            }
+        } else if(has_prefix(arg, "--cflags") || has_prefix(arg, "--cxxflags")) {
+            query.cxxflags = true;
+        } else if(has_prefix(arg, "--rcflags")) {
+            query.rcflags = true;
+        }
+    }
+
+    if(prefix.empty()) {
+        // WXWIN, or else the MSYS2 discovery of the full tool
+        prefix = get_env("WXWIN");
+        if(prefix.empty()) {
+            return false;
+        }
+    }
+    query.prefix << prefix;
+
+#if !WX_CONFIG_LEAN_MSYS2
+    if(config.empty()) {
+        config = get_env("WXCFG");
+        if(config.empty()) {
+            return false;
+        }
+    }
+    query.config << config;
+#endif
+    return !query.prefix.overflow() && !query.config.overflow();
+}
+
+void replace_backslashes(Path& path)
+{
+    char* data = path.data();
+    for(size_t i = 0; i < path.view().length(); ++i) {
+        if(data[i] == '\\') {
+            data[i] = '/';
+        }
+    }
+}
+
+/// \ -> /, then drop the trailing separators and blanks, as the full tools do
+void normalize_prefix(Path& path)
+{
+    replace_backslashes(path);
+    size_t last = path.view().find_last_not_of(" \t/");
+    path.truncate(last == string_view::npos ? 0 : last + 1);
+}
+
+bool write_all(string_view output)
+{
+#ifdef _WIN32
+    // _write() honors the text mode of stdout, like std::cout
+    return _write(1, output.data(), static_cast<unsigned>(output.length())) == static_cast<int>(output.length());
+#else
+    while(!output.empty()) {
+        ssize_t written = ::write(1, output.data(), output.length());
+        if(written <= 0) {
+            return false;
+        }
+        output.remove_prefix(static_cast<size_t>(written));
+    }
+    return true;
+#endif
+}
+
+/// run the full tool with the same arguments and return its exit code (on POSIX, become the full tool)
+int run_full_tool(char** argv)
+{
+#ifdef _WIN32
+    char self[MAX_PATH];
+    DWORD len = ::GetModuleFileNameA(nullptr, self, MAX_PATH);
+    if(len == 0 || len >= MAX_PATH) {
+        return 127;
+    }
+    string_view self_view(self, len);
+    Path exe;
+    exe << slice(self_view, 0, self_view.find_last_of("\\/") + 1) << kFullTool << ".exe";
+
+    // keep the original quoting: the command line of the full tool is ours, with argv[0] replaced
+    string_view command_line = ::GetCommandLineA();
+    size_t args_start = 0;
+    if(has_prefix(command_line, "\"")) {
+        args_start = command_line.find('"', 1);
+        args_start = args_start == string_view::npos ? command_line.length() : args_start + 1;
+    } else {
+        args_start = command_line.find_first_of(" \t");
+        args_start = args_start == string_view::npos ? command_line.length() : args_start;
+    }
+    FixedString<32768> full_command_line;
+    full_command_line << "\"" << exe.view() << "\"" << slice(command_line, args_start);
+    if(exe.overflow() || full_command_line.overflow()) {
+        return 127;
+    }
+
+    STARTUPINFOA startup_info = {};
+    startup_info.cb = sizeof(startup_info);
+    PROCESS_INFORMATION process_info = {};
+    if(!::CreateProcessA(exe.c_str(), const_cast<char*>(full_command_line.c_str()), nullptr, nullptr, TRUE, 0,
+           nullptr, nullptr, &startup_info, &process_info)) {
+        return 127;
+    }
+    ::WaitForSingleObject(process_info.hProcess, INFINITE);
+    DWORD exit_code = 127;
+    ::GetExitCodeProcess(process_info.hProcess, &exit_code);
+    ::CloseHandle(process_info.hThread);
+    ::CloseHandle(process_info.hProcess);
+    return static_cast<int>(exit_code);
+#else
+    Path exe;
+    char self[4096];
+    ssize_t len = -1;
+#ifdef __linux__
+    len = ::readlink("/proc/self/exe", self, sizeof(self));
+#endif
+    string_view self_view = len > 0 && size_t(len) < sizeof(self) ? string_view(self, size_t(len)) : argv[0];
+    size_t slash = self_view.find_last_of('/');
+    if(slash == string_view::npos) {
+        // started from PATH, so is the full tool
+        exe << kFullTool;
+        ::execvp(exe.c_str(), argv);
+    } else {
+        exe << slice(self_view, 0, slash + 1) << kFullTool;
+        ::execv(exe.c_str(), argv);
+    }
+    constexpr string_view message = ": could not run the full tool\n";
+    if(::write(2, exe.c_str(), exe.view().length()) < 0 || ::write(2, message.data(), message.length()) < 0) {
+        return 127;
+    }
+    return 127;
+#endif
+}
+
+#if WX_CONFIG_LEAN_MSYS2
+/// same as detect_wx_version(): the newest libwx_baseu-<major>.<minor> in `lib_dir`, false if there is none
+bool detect_wx_version(const Path& lib_dir, Path& version)
+{
+    size_t cur_weight = 0;
+    // the entry names do not outlive the directory handle, keep the best one
+    char major[32] = {}, minor[32] = {};
+    auto consider = [&](string_view name) {
+        Path path;
+        path << lib_dir.view() << "/" << name;
+        string_view tmp_major, tmp_minor;
+        if(!path.overflow() && match_wx_base_version(path.view(), tmp_major, tmp_minor)
+           && tmp_major.length() < sizeof(major) && tmp_minor.length() < sizeof(minor)) {
+            size_t weight = wx_version_weight(tmp_major, tmp_minor);
+            if(weight > cur_weight) {
+                memcpy(major, tmp_major.data(), tmp_major.length());
+                major[tmp_major.length()] = 0;
+                memcpy(minor, tmp_minor.data(), tmp_minor.length());
+                minor[tmp_minor.length()] = 0;
+                cur_weight = weight;
+            }
+        }
+    };
+
+#ifdef _WIN32
+    Path pattern;
+    pattern << lib_dir.view() << "/*";
+    WIN32_FIND_DATAA data;
+    HANDLE find = ::FindFirstFileA(pattern.c_str(), &data);
+    if(find == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    do {
+        string_view name = data.cFileName;
+        if(name != "." && name != "..") {
+            consider(name);
+        }
+    } while(::FindNextFileA(find, &data));
+    ::FindClose(find);
+#else
+    DIR* dir = ::opendir(lib_dir.c_str());
+    if(dir == nullptr) {
+        return false;
+    }
+    while(const dirent* entry = ::readdir(dir)) {
+        string_view name = entry->d_name;
+        if(name != "." && name != "..") {
+            consider(name);
+        }
+    }
+    ::closedir(dir);
+#endif
+
+    if(cur_weight == 0) {
+        return false;
+    }
+    version << major << "." << minor;
+    return true;
+}
+
+/// same as resolve_msys2_flags() followed by format_cflags() / format_rcflags() / format_libs()
+bool format_output(const Query& query, Output& out)
+{
+    Path lib_dir;
+    lib_dir << query.prefix.view() << "/lib";
+
+    Path wx_ver;
+    wx_ver << "-";
+    string_view user_ver = get_env("WXVER");
+    if(!user_ver.empty()) {
+        wx_ver << user_ver;
+    } else if(!detect_wx_version(lib_dir, wx_ver)) {
+        return false;
+    }
+
+    string_view prefix = query.prefix.view();
+    if(query.cxxflags || query.rcflags) {
+        for(string_view dir : kMsys2IncludeDirs) {
+            out << (query.cxxflags ? "-I" : "--include-dir ") << prefix << dir << wx_ver.view() << " ";
+        }
+    }
+    if(query.cxxflags) {
+        append_list(out, "", kGccCompileFlags);
+        append_list(out, "", kMswCompileFlags);
+    } else if(query.rcflags) {
+        append_list(out, "--define ", kRcDefines);
+    } else {
+        out << "-L" << lib_dir.view() << " ";
+        append_list(out, "", kLinkFlags);
+        for(size_t i = 0; i < query.lib_list_count; ++i) {
+            for_each_lib(query.lib_lists[i], [&](const WxLibInfo& lib) {
+                out << "-l";
+                append_msys2_lib_name(find_wx_lib(lib.name), wx_ver.view(), [&](string_view part) { out << part; });
+                out << " ";
+            });
+        }
+    }
+    return true;
+}
+#else
+/// a build.cfg read in a single buffer. Lookups walk the lines: there are a few dozens of them and a few lookups
+class LeanBuildCfg
+{
+    char m_data[65536];
+    size_t m_length = 0;
+
+    /// the value of the first `key=` line, like BuildCfg::get(). False if there is none
+    bool find(string_view key, string_view& value) const
+    {
+        string_view content(m_data, m_length);
+        while(!content.empty()) {
+            size_t eol = content.find('\n');
+            string_view line = slice(content, 0, eol);
+            content = eol == string_view::npos ? string_view() : slice(content, eol + 1);
+
+            size_t last = line.find_last_not_of("\r\n\t\v ");
+            line = last == string_view::npos ? string_view() : slice(line, 0, last + 1);
+            size_t eq = line.find('=');
+            if(eq != string_view::npos && slice(line, 0, eq) == key) {
+                value = slice(line, eq + 1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    /// false if the file can not be read, is too large or lacks a required key
+    bool load(const char* path)
+    {
+#ifdef _WIN32
+        HANDLE file = ::CreateFileA(
+            path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if(file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        DWORD count = 0;
+        bool ok = ::ReadFile(file, m_data, sizeof(m_data), &count, nullptr);
+        ::CloseHandle(file);
+        if(!ok) {
+            return false;
+        }
+        m_length = count;
+#else
+        int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if(fd < 0) {
+            return false;
+        }
+        ssize_t count = 0;
+        while((count = ::read(fd, m_data + m_length, sizeof(m_data) - m_length)) > 0) {
+            m_length += size_t(count);
+        }
+        ::close(fd);
+        if(count < 0) {
+            return false;
+        }
+#endif
+        if(m_length == sizeof(m_data)) {
+            return false;
+        }
+        string_view value;
+        for(string_view key : BuildCfg::kRequiredKeys) {
+            if(!find(key, value)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    string_view get(string_view key) const
+    {
+        string_view value;
+        return find(key, value) ? value : string_view();
+    }
+};
+
+LeanBuildCfg build_cfg;
+
+/// same as get_local_lib_name()
+void append_lib_name(Output& out, WxLib lib)
+{
+    out << "-l";
+    append_local_lib_name(kWxLibs[lib].name, build_cfg.get("WXVER_MAJOR"), build_cfg.get("WXVER_MINOR"),
+        build_cfg.get("BUILD") == "debug", build_cfg.get("MONOLITHIC") == "1", [&](string_view part) { out << part; });
+    out << " ";
+}
+
+/// same as resolve_local_flags() followed by format_cflags() / format_rcflags() / format_libs()
+bool format_output(const Query& query, Output& out)
+{
+    string_view prefix = query.prefix.view();
+    string_view config = query.config.view();
+    Path path;
+    path << prefix << "/lib/" << config << "/build.cfg";
+    if(path.overflow() || !build_cfg.load(path.c_str())) {
+        return false;
+    }
+
+    if(query.cxxflags) {
+        out << "-I" << prefix << "/lib/" << config << " ";
+        out << "-I" << prefix << "/include ";
+        if(build_cfg.get("COMPILER") != "clang") {
+            append_list(out, "", kGccCompileFlags);
+        } else {
+            append_list(out, "", kClangCompileFlags);
+        }
+        append_list(out, "", kMswCompileFlags);
+        if(build_cfg.get("BUILD") == "release") {
+            append_list(out, "", kReleaseCompileFlags);
+        }
+        if(!build_cfg.get("CXXFLAGS").empty()) {
+            out << build_cfg.get("CXXFLAGS") << " ";
+        }
+    } else if(query.rcflags) {
+        out << "--include-dir " << prefix << "/lib/" << config << " ";
+        out << "--include-dir " << prefix << "/include ";
+        append_list(out, "--define ", kRcDefines);
+    } else {
+        // before_first(config, "/"): empty without a separator
+        size_t slash = config.find('/');
+        out << "-L" << prefix << "/lib/" << (slash == string_view::npos ? string_view() : slice(config, 0, slash))
+            << " ";
+        append_list(out, "", kLinkFlags);
+        if(build_cfg.get("MONOLITHIC") == "1") {
+            bool gl = false;
+            for(size_t i = 0; i < query.lib_list_count; ++i) {
+                gl = gl || (query.lib_lists[i] & lib_bit(kLibGl));
+            }
+            append_lib_name(out, kLibBase);
+            if(gl) {
+                append_lib_name(out, kLibGl);
+            }
+        } else {
+            for(size_t i = 0; i < query.lib_list_count; ++i) {
+                for_each_lib(query.lib_lists[i],
+                    [&](const WxLibInfo& lib) { append_lib_name(out, WxLib(find_wx_lib(lib.name))); });
+            }
+        }
+    }
+    return true;
+}
+#endif
+
+Output output;
+Query query;
+}
+
+int main(int argc, char** argv)
+{
+    if(!parse_query(argc, argv, query)) {
+        return run_full_tool(argv);
+    }
+    normalize_prefix(query.prefix);
+    replace_backslashes(query.config);
+
+    bool ok = format_output(query, output);
+    output << "\n";
+    if(!ok || output.overflow()) {
+        return run_full_tool(argv);
+    }
+    return write_all(output.view()) ? 0 : 1;
+}
@@ -1,135 +1,195 @@
+#include "auto_libs.hpp"
+#include "bake.hpp"
+#include "cache.hpp"
+#include "header_units.hpp"
+#include "lib_index.hpp"
+#include "msys2_discovery.hpp"
+#include "msys2_install.hpp"
+#include "pch.hpp"
+#include "server.hpp"
+#include "trace.hpp"
 #include "utils.hpp"
-#include <filesystem>
+#include "wx_flags.hpp"
 #include <iostream>
-#include <regex>
 #include <sstream>
 #include <string>
-#include <unordered_map>
-#include <vector>
+#include <string_view>
 
 using namespace std;
 
 namespace
 {
-vector<pair<string, string>> all_libs = {
-    { "xrc", "wx_mswu_xrc" },
-    { "webview", "wx_mswu_webview" },
-    { "stc", "wx_mswu_stc" },
-    { "richtext", "wx_mswu_richtext" },
-    { "ribbon", "wx_mswu_ribbon" },
-    { "propgrid", "wx_mswu_propgrid" },
-    { "aui", "wx_mswu_aui" },
-    { "gl", "wx_mswu_gl" },
-    { "html", "wx_mswu_html" },
-    { "qa", "wx_mswu_qa" },
-    { "core", "wx_mswu_core" },
-    { "xml", "wx_baseu_xml" },
-    { "net", "wx_baseu_net" },
-    { "base", "wx_baseu" },
-    { "adv", "wx_mswu_adv" },
-    { "media", "wx_mswu_media" },
-};
-
-unordered_map<string, string> libs_map;
-
-string find_wx_version(const string& install_dir)
+int run_query(int argc, char** argv, bool use_cache)
 {
-    // check if the user provided us with a version to use
-    string user_ver = safe_getenv("WXVER");
-    if(!user_ver.empty()) {
-        return user_ver;
+    CommandLineParser parser(argc, argv);
+    parser.set_prefix_discovery(discover_msys2_prefix);
+    {
+        TraceScope scope("parse_args");
+        parser.parse_args();
     }
+    auto prefix = parser.get_prefix();
+    trim(prefix, true, " \t\\/");
+    replace(prefix.begin(), prefix.end(), '\\', DIR_SEP);
 
-    regex re("libwx_baseu\\-([\\d]+)[\\.]{1}([\\d]+)");
-    size_t cur_weight = 0;
-    string major, minor;
-    if(!filesystem::is_directory(install_dir)) {
-        cerr << "Directory: " << install_dir << " does not exist" << endl;
-        cerr << "Could not determine wxWidgets version installed. Please set WXVER or ensure that the --prefix "
-                "provided is correct"
-             << endl;
-        exit(4);
+    // serve the output from the cache when the lib dir did not change since the last identical query. Generated build
+    // files are written into the working directory, so these always run
+    ResultCache cache("wx-config-msys2", argc, argv);
+    cache.add_key(prefix);
+    cache.add_input(prefix + "/lib");
+    for(const auto& object : parser.get_objects()) {
+        cache.add_input(object);
     }
-
-    for(const auto& entry : filesystem::directory_iterator(install_dir)) {
-        auto path = entry.path().string();
-        if(path.find("libwx_baseu-") != -1) {
-            smatch m;
-            if(regex_search(path, m, re)) {
-                string tmp_major, tmp_minor;
-                tmp_major = m[1];
-                tmp_minor = m[2];
-                size_t weight = (atoi(tmp_major.c_str()) * 100) + (atoi(tmp_minor.c_str()) * 10);
-                if(weight > cur_weight) {
-                    major.swap(tmp_major);
-                    minor.swap(tmp_minor);
-                    cur_weight = weight;
-                }
-            }
-        }
+    if(parser.is_remap_prefix()) {
+        cache.add_key(safe_getenv("WXCONFIG_PREFIX_MAP"));
     }
-
-    if(cur_weight == 0) {
-        cerr << "Could not determine wxWidgets version installed. Please set WXVER or ensure that the --prefix "
-                "provided is correct"
-             << endl;
-        exit(3);
+    // a --profile output depends on the compiler found in PATH: validating an entry would cost as much as the toolchain
+    // lookup itself
+    if(!use_cache || parser.is_no_cache() || parser.is_generate_files() || parser.is_pch() || parser.is_bake()
+       || parser.is_header_units() || parser.is_response_file() || parser.get_profile() != BuildProfile::kNone) {
+        cache.disable();
     }
-    return major + "." + minor;
-}
-}
 
-int main(int argc, char** argv)
-{
-    CommandLineParser parser(argc, argv);
-    parser.parse_args();
-    auto prefix = parser.get_prefix();
-    trim(prefix, true, " \t\\/");
-    replace(prefix.begin(), prefix.end(), '\\', DIR_SEP);
+    string cached_output;
+    bool cache_hit = false;
+    {
+        TraceScope scope("cache_lookup");
+        cache_hit = cache.lookup(cached_output);
+    }
+    if(cache_hit) {
+        cout << cached_output << flush;
+        return 0;
+    }
 
     // ----------------------------------------
     // append the wx version to all the libs
     // ----------------------------------------
-    string wx_ver = find_wx_version(prefix + "/lib");
-    wx_ver.insert(0, "-");
-    for(auto& p : all_libs) {
-        p.second.append(wx_ver);
-        libs_map.insert(p);
+    string wx_ver;
+    {
+        TraceScope scope("find_wx_version");
+        wx_ver = find_wx_version(prefix + "/lib");
     }
+    wx_ver.insert(0, "-");
 
-    // Now that we updated libs_map, re-parse the data
-    parser.parse_args();
+    if(parser.is_auto_libs()) {
+        TraceScope scope("auto_libs");
+        parser.set_libs(resolve_auto_libs(parser.get_objects(), parser.get_libs(), prefix + "/lib",
+            [&wx_ver](const string& lib) { return get_msys2_lib_name(lib, wx_ver); }));
+    }
 
-    stringstream ss;
-    if(parser.is_cxxflags_set()) {
-        // print compile flags
-        ss << "-I" << prefix << "/lib/wx/include/msw-unicode" << wx_ver << " ";
-        ss << "-I" << prefix << "/include/wx" << wx_ver << " ";
-        ss << "-mthreads ";
-        ss << "-D_FILE_OFFSET_BITS=64 ";
-        ss << "-DWXUSINGDLL ";
-        ss << "-D__WXMSW__ ";
-        ss << "-DHAVE_W32API_H ";
-        ss << "-D_UNICODE ";
-        ss << "-fmessage-length=0 ";
-        ss << "-pipe ";
+    auto resolve = [&](const vector<string>& libs) {
+        WxFlags flags = resolve_msys2_flags(libs, prefix, wx_ver);
+        apply_build_profile(parser.get_profile(), get_default_pch_compiler(flags), flags);
+        if(parser.is_absolute()) {
+            resolve_lib_files(flags, parser.is_prefer_static() ? LibPolicy::kPreferStatic : LibPolicy::kPreferImport);
+        }
+        if(parser.is_canonical()) {
+            canonicalize_flags(flags);
+        }
+        if(parser.is_remap_prefix()) {
+            remap_prefix(flags, get_prefix_alias(flags.prefix, parser.get_prefix_alias()));
+        }
+        return flags;
+    };
+    if(parser.is_bake()) {
+        // wx-config-msys2 has no --cmake
+        TraceScope scope("bake");
+        bake(parser, resolve, "");
+        return 0;
+    }
 
-    } else if(parser.is_rcflags_set()) {
-        // print resource compiler flags
-        ss << "--include-dir " << prefix << "/lib/wx/include/msw-unicode" << wx_ver << " ";
-        ss << "--include-dir " << prefix << "/include/wx" << wx_ver << " ";
-        ss << "--define __WXMSW__ ";
-        ss << "--define _UNICODE ";
-        ss << "--define WXUSINGDLL ";
-    } else {
-        // print linker flags
-        const auto& libs = parser.get_libs();
+    WxFlags flags;
+    {
+        TraceScope scope("resolve_flags");
+        flags = resolve(parser.get_libs());
+    }
+    if(parser.is_pch()) {
+        TraceScope scope("build_pch");
+        string compiler = parser.get_pch_compiler();
+        cout << build_pch(flags, compiler.empty() ? get_default_pch_compiler(flags) : compiler) << endl;
+        return 0;
+    }
+    if(parser.is_header_units()) {
+        TraceScope scope("build_header_units");
+        string compiler = parser.get_header_units_compiler();
+        cout << build_header_units(
+            flags, parser.get_libs(), compiler.empty() ? get_default_pch_compiler(flags) : compiler)
+             << endl;
+        return 0;
+    }
+    if(parser.is_generate_files()) {
+        TraceScope scope("generate_files");
+        auto generated = generate_build_files(parser, flags);
+        vector<string> inputs = { prefix + "/lib", prefix };
+        inputs.insert(inputs.end(), parser.get_objects().begin(), parser.get_objects().end());
+        write_depfile(parser, generated, inputs);
+        return 0;
+    }
 
-        ss << "-L" << prefix << "/lib -pipe ";
-        for(const auto& lib : libs) {
-            ss << "-l" << libs_map[lib] << " ";
+    stringstream ss;
+    {
+        TraceScope scope("format_output");
+        if(parser.is_json()) {
+            ss << format_json(flags);
+        } else if(parser.is_response_file()) {
+            // a single short argument, stable for a given set of flags
+            vector<string> args = parser.is_cxxflags_set() ? cflags_list(flags)
+                                  : parser.is_rcflags_set() ? rcflags_list(flags)
+                                                            : libs_list(flags);
+            ss << "@" << write_response_file(args, parser.get_response_file_dir());
+        } else if(parser.is_cxxflags_set()) {
+            // print compile flags
+            ss << format_cflags(flags);
+        } else if(parser.is_rcflags_set()) {
+            // print resource compiler flags
+            ss << format_rcflags(flags);
+        } else {
+            // print linker flags
+            ss << format_libs(flags);
         }
     }
+
+    TraceScope scope("write_output");
     cout << ss.str() << endl;
+    cache.store(ss.str() + "\n");
     return 0;
 }
+}
+
+int main(int argc, char** argv)
+{
+    if(has_arg(argc, argv, "--server")) {
+        QueryServer server("wx-config-msys2");
+        return finish_msys2_probes(server.run([](int argc, char** argv) { return run_query(argc, argv, false); },
+            []() {
+                reset_msys2_state();
+                reset_auto_libs_state();
+                reset_lib_index_state();
+            }));
+    }
+
+    // the MSYS2 discovery may leave probes running: every exit goes through finish_msys2_probes(), fatal errors
+    // included
+    set_fatal_exit_throws(true);
+    int exit_code = 0;
+    {
+        TraceSession trace("wx-config-msys2", argc, argv);
+        try {
+            // the prefix discovery depends on our environment (MSYSTEM, PATH), the server can not run it
+            bool discover_prefix = safe_getenv("WXWIN").empty() && none_of(argv + 1, argv + argc, [](const char* arg) {
+                return string_view(arg).starts_with("--prefix");
+            });
+            bool forwarded = false;
+            if(!has_generator_arg(argc, argv) && !discover_prefix) {
+                TraceScope scope("forward_query");
+                forwarded = forward_query("wx-config-msys2", argc, argv, exit_code);
+            }
+            if(!forwarded) {
+                exit_code = run_query(argc, argv, true);
+            }
+        } catch(const FatalExit& e) {
+            trace.flush(false);
+            exit_code = e.code;
+        }
+    }
+    return finish_msys2_probes(exit_code);
+}
@@ -1,159 +1,239 @@
+#include "auto_libs.hpp"
+#include "bake.hpp"
+#include "cache.hpp"
+#include "header_units.hpp"
+#include "lib_catalog.hpp"
+#include "lib_index.hpp"
+#include "local_install.hpp"
+#include "pch.hpp"
+#include "server.hpp"
+#include "trace.hpp"
 #include "utils.hpp"
-#include <filesystem>
-#include <fstream>
+#include "wx_flags.hpp"
+#include <algorithm>
+#include <functional>
 #include <iostream>
-#include <regex>
 #include <sstream>
 #include <string>
-#include <unordered_map>
-#include <vector>
 
 namespace
 {
-unordered_map<string, string> build_cfg;
-unordered_map<string, string> libs_map;
-
-/**
- * @brief are we using monolithic build of wxWidgets?
- */
-bool is_monolithic() { return build_cfg.count("MONOLITHIC") == 1 && build_cfg["MONOLITHIC"] == "1"; }
-}
-
-void parse_build_cfg(const string& install_dir, const string& config)
+/// `str` as a quoted CMake argument. `;` is escaped too, so the result is a single list element
+string cmake_quote(const string& str)
 {
-    // parse the build.cfg file
-    stringstream ss;
-    ss << install_dir << DIR_SEP << "lib" << DIR_SEP << config << DIR_SEP << "build.cfg";
-
-    if(!filesystem::exists(ss.str())) {
-        cerr << "could not open configuration file: " << ss.str() << endl;
-        exit(1);
-    }
-
-    ifstream infile(ss.str());
-    unordered_set<string> keys = { "WXVER_MAJOR", "WXVER_MINOR", "WXVER_RELEASE", "CXXFLAGS", "CXXFLAGS", "BUILD",
-        "MONOLITHIC", "VENDOR", "COMPILER" };
-
-    string line;
-    while(getline(infile, line) && !keys.empty()) {
-        trim(line);
-        string key = before_first(line, "=");
-        string value = after_first(line, "=");
-
-        if(keys.count(key)) {
-            keys.erase(key);
-            build_cfg.insert({ key, value });
+    string result = "\"";
+    for(char ch : str) {
+        if(ch == '\\' || ch == '"' || ch == '$' || ch == ';') {
+            result += '\\';
         }
+        result += ch;
     }
-
-    if(!keys.empty()) {
-        // not all keys were processed
-        cerr << "failed to parse build.cfg file: " << ss.str() << endl;
-        exit(1);
-    }
+    result += "\"";
+    return result;
 }
 
-/// Add include path to the output
-void add_include_dir(const CommandLineParser& parser, stringstream& ss, const string& path)
+/// `items` as a quoted CMake list
+string cmake_list(const vector<string>& items)
 {
-    if(parser.is_create_cmake_file()) {
-        ss << "include_directories(" << path << ")\n";
-    } else if(parser.is_cxxflags_set()) {
-        ss << "-I" << path << " ";
+    string result;
+    for(const auto& item : items) {
+        string quoted = cmake_quote(item);
+        result += (result.empty() ? "" : ";") + quoted.substr(1, quoted.size() - 2);
     }
+    return "\"" + result + "\"";
+}
 }
 
-/// Add compiler definition to the output (can be -D or some other flag like -fPIC)
-void add_macros(const CommandLineParser& parser, stringstream& ss)
+/**
+ * @brief The content of wxWidgets.cmake: an IMPORTED target per wx library (wx::base, wx::core, ...)
+ *
+ * A target points at its import library and links the targets of the libraries it depends on. wx::base, which every
+ * other target links, carries the include dirs, macros and compile / link options. Targets are created for the
+ * installed libraries and the `requested` ones; a library whose import library can not be found becomes an INTERFACE
+ * target linking it by name. wxWidgets_LIBRARIES lists the targets of the `requested` libraries
+ */
+string format_cmake(
+    const WxFlags& flags, const vector<string>& requested, const function<string(const string& lib)>& file_name_of)
 {
-    string compiler = build_cfg["COMPILER"];
-    vector<string> macros;
-    if(compiler != "clang") {
-        macros.push_back("-mthreads");
-    } else {
-        // when compiled with clang, wxWidgets generates tones of these errors
-        // lets disable them...
-        macros.push_back("-Wno-ignored-attributes");
-        macros.push_back("-Wno-unknown-pragmas");
-        macros.push_back("-Wno-unused-private-field");
+    string lib_dir = flags.lib_dirs.empty() ? string() : flags.lib_dirs[0];
+
+    LibSet requested_set = 0;
+    for(const auto& lib : requested) {
+        if(int index = find_wx_lib(lib); index >= 0) {
+            requested_set |= LibSet(1) << index;
+        }
     }
 
-    macros.push_back("-D_FILE_OFFSET_BITS=64");
-    macros.push_back("-DWXUSINGDLL");
-    macros.push_back("-D__WXMSW__");
-    macros.push_back("-DHAVE_W32API_H");
-    macros.push_back("-D_UNICODE");
-    macros.push_back("-fmessage-length=0");
-    macros.push_back("-pipe");
+    // the libraries that get a target, with their dependencies. Link order means a library is seen before its
+    // dependencies, so a single pass is enough
+    LibSet wanted = requested_set;
+    vector<pair<const WxLibInfo*, string>> targets; // lib -> import library (empty if not found)
+    for(size_t i = 0; i < kWxLibs.size(); ++i) {
+        const WxLibInfo& lib = kWxLibs[i];
+        // monolithic builds have a single library, plus gl
+        bool aliased = flags.monolithic && i != kLibBase && i != kLibGl;
+        string path = aliased ? string() : find_import_library(lib_dir, file_name_of(string(lib.name)));
+        if(!aliased && path.empty() && !(wanted & (LibSet(1) << i))) {
+            continue;
+        }
+        wanted |= lib.deps;
+        targets.push_back({ &lib, path });
+    }
 
-    if(build_cfg["BUILD"] == "release") {
-        macros.push_back("-DwxDEBUG_LEVEL=0");
+    vector<string> defines;
+    vector<string> options;
+    for(const auto& flag : flags.compile_flags) {
+        if(flag.starts_with("-D")) {
+            defines.push_back(flag.substr(2));
+        } else {
+            options.push_back(flag);
+        }
+    }
+    for(const auto& flag : split_args(flags.extra_cxxflags)) {
+        options.push_back(flag);
     }
+    options.insert(options.end(), flags.profile_flags.begin(), flags.profile_flags.end());
 
-    for(const auto& def : macros) {
-        if(parser.is_create_cmake_file()) {
-            ss << "add_definitions(" << def << ")\n";
-        } else if(parser.is_cxxflags_set()) {
-            ss << def << " ";
+    stringstream ss;
+    ss << "if(NOT TARGET wx::base)\n";
+    // emit the dependencies first, it reads better
+    for(auto iter = targets.rbegin(); iter != targets.rend(); ++iter) {
+        const auto& [lib, path] = *iter;
+        string target = "wx::" + string(lib->name);
+        vector<string> link_libraries;
+        if(flags.monolithic && lib->name != "base" && lib->name != "gl") {
+            link_libraries.push_back("wx::base");
+        } else {
+            if(path.empty()) {
+                link_libraries.push_back(file_name_of(string(lib->name)));
+            }
+            for_each_lib(lib->deps, [&link_libraries](const WxLibInfo& dep) {
+                link_libraries.push_back("wx::" + string(dep.name));
+            });
+        }
+
+        ss << "    add_library(" << target << (path.empty() ? " INTERFACE" : " UNKNOWN") << " IMPORTED GLOBAL)\n";
+        ss << "    set_target_properties(" << target << " PROPERTIES";
+        if(!path.empty()) {
+            ss << "\n        IMPORTED_LOCATION " << cmake_quote(path);
+        } else if(link_libraries.size() && !link_libraries[0].starts_with("wx::")) {
+            ss << "\n        INTERFACE_LINK_DIRECTORIES " << cmake_quote(lib_dir);
+        }
+        if(lib->name == "base") {
+            ss << "\n        INTERFACE_INCLUDE_DIRECTORIES " << cmake_list(flags.include_dirs);
+            ss << "\n        INTERFACE_COMPILE_DEFINITIONS " << cmake_list(defines);
+            ss << "\n        INTERFACE_COMPILE_OPTIONS " << cmake_list(options);
+            ss << "\n        INTERFACE_LINK_OPTIONS " << cmake_list(flags.link_flags);
+        }
+        if(!link_libraries.empty()) {
+            ss << "\n        INTERFACE_LINK_LIBRARIES " << cmake_list(link_libraries);
         }
+        ss << ")\n";
     }
+    ss << "endif()\n";
+
+    vector<string> libraries;
+    for_each_lib(requested_set, [&libraries](const WxLibInfo& lib) { libraries.push_back("wx::" + string(lib.name)); });
+    ss << "set(wxWidgets_LIBRARIES " << cmake_list(libraries) << ")\n";
+
+    // CMake (3.16+) builds the precompiled header itself, with the target's own flags
+    ss << "\n## Precompile the wxWidgets headers of a target:\n";
+    ss << "## wx_target_precompile_headers(<target>)\n";
+    ss << "function(wx_target_precompile_headers target)\n";
+    ss << "    target_precompile_headers(${target} PRIVATE <wx/wx.h>)\n";
+    ss << "endfunction()\n";
+
+    // the header units are built by wx-config itself, with the compiler of the project, when CMake configures it
+    string lib_list;
+    for(const auto& lib : requested) {
+        lib_list += (lib_list.empty() ? "" : ",") + lib;
+    }
+    ss << "\n## Import the wxWidgets headers of a target as C++20 header units (import <wx/wx.h>;), built once per\n";
+    ss << "## config and compiler: wx_target_header_units(<target>)\n";
+    ss << "find_program(wxWidgets_CONFIG_EXECUTABLE wx-config)\n";
+    ss << "function(wx_target_header_units target)\n";
+    ss << "    execute_process(\n";
+    ss << "        COMMAND \"${wxWidgets_CONFIG_EXECUTABLE}\" " << cmake_quote("--prefix=" + flags.prefix) << " "
+       << cmake_quote("--wxcfg=" + flags.config) << " --libs " << cmake_quote(lib_list.empty() ? "std" : lib_list)
+       << "\n";
+    ss << "                \"--header-units=${CMAKE_CXX_COMPILER}\"\n";
+    ss << "        OUTPUT_VARIABLE flags\n";
+    ss << "        OUTPUT_STRIP_TRAILING_WHITESPACE\n";
+    ss << "        RESULT_VARIABLE result)\n";
+    ss << "    if(NOT result EQUAL 0)\n";
+    ss << "        message(FATAL_ERROR \"wx-config --header-units failed for ${target}\")\n";
+    ss << "    endif()\n";
+    ss << "    separate_arguments(flags NATIVE_COMMAND \"${flags}\")\n";
+    ss << "    target_compile_options(${target} PRIVATE ${flags})\n";
+    ss << "endfunction()\n";
+    return ss.str();
 }
 
-/// Build the libs string
-void add_libs(const CommandLineParser& parser, const string& config, const string& prefix, stringstream& out_stream)
+/// the full content of the wxWidgets.cmake file written by --cmake
+string format_cmake_file(const WxFlags& flags, const vector<string>& requested)
 {
-    string build = build_cfg["BUILD"];
-    string debug_lib_suffix;
-    if(build == "debug")
-        debug_lib_suffix = "d";
+    stringstream ss;
+    ss << "## Auto Generated by wx-config: https://github.com/eranif/wx-config-msys2\n";
+    ss << "## Include this file in your CMakeLists.txt:\n";
+    ss << "## include(wxWidgets.cmake)\n";
+    ss << "## ..\n";
+    ss << "## And link the wxWidgets targets (this also adds their include dirs and macros):\n";
+    ss << "## target_link_libraries(... ${wxWidgets_LIBRARIES})\n";
+    ss << "## or pick them one by one: target_link_libraries(... wx::aui wx::core)\n\n";
+    ss << format_cmake(flags, requested, [](const string& lib) { return get_local_lib_name(get_build_cfg(), lib); });
+    return ss.str() + "\n";
+}
 
-    // for non monolithic libs, the release lib name could be: wxmsw32u_base or wxmsw32u_xml
-    // the debug lib name could be: wxmsw32ud_base or wxmsw32ud_xml
-    string unicode_suffix = "u";
-    unicode_suffix += debug_lib_suffix;
+/// --list-configs / --manifest: resolve every config under the prefix in one pass
+int print_all_configs(const CommandLineParser& parser, const string& prefix)
+{
+    vector<string> configs;
+    {
+        TraceScope scope("find_configs");
+        configs = find_local_configs(prefix);
+    }
+    if(configs.empty()) {
+        cerr << "could not find any build.cfg file under: " << prefix << DIR_SEP << "lib" << endl;
+        fatal_exit(1);
+    }
 
-    stringstream ss;
+    vector<LocalConfigFlags> results;
+    {
+        TraceScope scope("resolve_all_flags");
+        results = resolve_all_local_flags(parser.get_libs(), prefix, configs);
+    }
 
-    // print linker flags
-    ss << "-L" << prefix << DIR_SEP << "lib" << DIR_SEP << before_first(config, DIR_SEP_STR) << " "
-       << "-pipe ";
-
-    if(is_monolithic()) {
-        // monolithic lib
-        stringstream libname;
-        // example: libwxmsw31u.a or libwxmsw31ud.a
-        libname << "wxmsw" << build_cfg["WXVER_MAJOR"] << build_cfg["WXVER_MINOR"] << unicode_suffix;
-        ss << "-l" << libname.str() << " ";
-        // in the monolithic mode, there are usually two lib files, the common is libwxmsw32u.a, the other file is libwxmsw32u_gl.a
-        // this means the wx's opengl support library is always a seperate library, so check to see whether the "gl" option is added
-        // finally, we got the linker option line such as: "-lwxmsw32u -lwxmsw32u_gl"
-        if (parser.contains_lib("gl")) {
-            ss << "-l" << libname.str() << "_gl" << " ";
-        }
-    } else {
-        // translate lib name to file name
-        const auto& libs = parser.get_libs();
-        for(const auto& lib : libs) {
-            if(libs_map.count(lib)) {
-                ss << "-l" << libs_map[lib] << " ";
-            }
+    // broken configs are reported and left out
+    vector<WxFlags> resolved;
+    for(auto& result : results) {
+        if(!result.error.empty()) {
+            cerr << result.error << endl;
+            continue;
         }
+        resolved.push_back(std::move(result.flags));
     }
 
-    if(parser.is_create_cmake_file()) {
-        string libs = ss.str();
-        trim(libs);
-
-        out_stream << "set(wxWidgets_LIBRARIES \"" << libs << "\")\n";
+    TraceScope scope("write_output");
+    if(!parser.is_manifest()) {
+        for(const auto& flags : resolved) {
+            cout << flags.config << "\n";
+        }
+        cout << flush;
+    } else if(parser.get_manifest_file().empty()) {
+        cout << format_manifest("wx-config", prefix, resolved) << endl;
     } else {
-        out_stream << ss.str();
+        write_generated_file(parser.get_manifest_file(), format_manifest("wx-config", prefix, resolved) + "\n");
     }
+    return 0;
 }
 
-int main(int argc, char** argv)
+int run_query(int argc, char** argv, bool use_cache)
 {
     CommandLineParser parser(argc, argv);
-    parser.parse_args(true);
+    {
+        TraceScope scope("parse_args");
+        parser.parse_args(true);
+    }
     auto prefix = parser.get_prefix();
     auto config = parser.get_config();
 
@@ -161,87 +241,165 @@ int main(int argc, char** argv)
     replace(prefix.begin(), prefix.end(), '\\', DIR_SEP);
     trim(prefix, true, " \t\\/");
 
-    parse_build_cfg(prefix, config);
-    // populate the lib map
-
-    string version_num = build_cfg["WXVER_MAJOR"] + build_cfg["WXVER_MINOR"];
-    string cxxflags = build_cfg["CXXFLAGS"];
-    string compiler = build_cfg["COMPILER"];
-    string build = build_cfg["BUILD"];
-    string vendor = build_cfg["VENDOR"];
-
-    string debug_lib_suffix;
-    if(build == "debug")
-        debug_lib_suffix = "d";
-
-    // for non monolithic libs, the release lib name could be: wxmsw32u_base or wxmsw32u_xml
-    // the debug lib name could be: wxmsw32ud_base or wxmsw32ud_xml
-    string unicode_suffix = "u";
-    unicode_suffix += debug_lib_suffix;
-
-    const auto& libs = parser.get_libs();
-    for(const auto& lib : libs) {
-        if(lib == "base") {
-            libs_map.insert({ lib, "wx" + lib + version_num + unicode_suffix });
-        } else if(lib == "net" || lib == "xml") {
-            libs_map.insert({ lib, "wxbase" + version_num + unicode_suffix + "_" + lib });
-        } else {
-            libs_map.insert({ lib, "wxmsw" + version_num + unicode_suffix + "_" + lib });
+    if(parser.is_list_configs() || parser.is_manifest()) {
+        return print_all_configs(parser, prefix);
+    }
+
+    // serve the output from the cache when build.cfg did not change since the last identical query. --cmake (and the
+    // other generators) write files into the working directory, so these always run
+    ResultCache cache("wx-config", argc, argv);
+    cache.add_input(prefix + DIR_SEP + "lib" + DIR_SEP + config + DIR_SEP + "build.cfg");
+    cache.add_input(prefix + DIR_SEP + "lib");
+    cache.add_input(prefix + DIR_SEP + "lib" + DIR_SEP + before_first(config, DIR_SEP_STR));
+    for(const auto& object : parser.get_objects()) {
+        cache.add_input(object);
+    }
+    if(parser.is_remap_prefix()) {
+        cache.add_key(safe_getenv("WXCONFIG_PREFIX_MAP"));
+    }
+    // a --profile output depends on the compiler found in PATH: validating an entry would cost as much as the toolchain
+    // lookup itself. The other queries only read build.cfg (or its snapshot), which costs less than a cache hit (the
+    // input stamps + the entry): only the ones that list the lib dir or read objects are worth caching
+    if(!use_cache || parser.is_no_cache() || parser.is_generate_files() || parser.is_pch() || parser.is_bake()
+       || parser.is_header_units() || parser.is_response_file() || parser.get_profile() != BuildProfile::kNone
+       || !(parser.is_absolute() || parser.is_auto_libs())) {
+        cache.disable();
+    }
+
+    string cached_output;
+    bool cache_hit = false;
+    {
+        TraceScope scope("cache_lookup");
+        cache_hit = cache.lookup(cached_output);
+    }
+    if(cache_hit) {
+        cout << cached_output << flush;
+        return 0;
+    }
+
+    {
+        TraceScope scope("parse_build_cfg");
+        parse_build_cfg(prefix, config);
+    }
+
+    if(parser.is_auto_libs()) {
+        TraceScope scope("auto_libs");
+        string lib_dir = prefix + DIR_SEP + "lib" + DIR_SEP + before_first(config, DIR_SEP_STR);
+        parser.set_libs(resolve_auto_libs(parser.get_objects(), parser.get_libs(), lib_dir,
+            [](const string& lib) { return get_local_lib_name(get_build_cfg(), lib); }));
+    }
+
+    auto resolve = [&](const vector<string>& libs) {
+        WxFlags flags = resolve_local_flags(get_build_cfg(), libs, prefix, config);
+        apply_build_profile(parser.get_profile(), get_default_pch_compiler(flags), flags);
+        if(parser.is_absolute()) {
+            resolve_lib_files(flags, parser.is_prefer_static() ? LibPolicy::kPreferStatic : LibPolicy::kPreferImport);
+        }
+        if(parser.is_canonical()) {
+            canonicalize_flags(flags);
         }
+        if(parser.is_remap_prefix()) {
+            remap_prefix(flags, get_prefix_alias(flags.prefix, parser.get_prefix_alias()));
+        }
+        return flags;
+    };
+    if(parser.is_bake()) {
+        // --cmake is baked as it is written without --libs
+        TraceScope scope("bake");
+        bake(parser, resolve, format_cmake_file(resolve({}), {}));
+        return 0;
+    }
+
+    WxFlags flags;
+    {
+        TraceScope scope("resolve_flags");
+        flags = resolve(parser.get_libs());
+    }
+    if(parser.is_pch()) {
+        TraceScope scope("build_pch");
+        string compiler = parser.get_pch_compiler();
+        cout << build_pch(flags, compiler.empty() ? get_default_pch_compiler(flags) : compiler) << endl;
+        return 0;
+    }
+    if(parser.is_header_units()) {
+        TraceScope scope("build_header_units");
+        string compiler = parser.get_header_units_compiler();
+        cout << build_header_units(
+            flags, parser.get_libs(), compiler.empty() ? get_default_pch_compiler(flags) : compiler)
+             << endl;
+        return 0;
     }
 
     stringstream ss;
-    if(parser.is_create_cmake_file()) {
-        // When --cmake is passed, we generate a wxWidgets.cmake file to be included
-        // in the user CMakeLists
-        ss << "## Auto Generated by wx-config: https://github.com/eranif/wx-config-msys2\n";
-        ss << "## Include this file in your CMakeLists.txt:\n";
-        ss << "## include(wxWidgets.cmake)\n";
-        ss << "## ..\n";
-        ss << "## And add this variable to link againt wxWidgets libraries:\n";
-        ss << "## target_link_libraries(... ${wxWidgets_LIBRARIES}\n\n";
-
-        add_include_dir(parser, ss, prefix + DIR_SEP + "lib" + DIR_SEP + config);
-        add_include_dir(parser, ss, prefix + DIR_SEP + "include");
-        add_macros(parser, ss);
-        add_libs(parser, config, prefix, ss);
-
-        ofstream out_file("wxWidgets.cmake", ios_base::out | ios_base::trunc);
-        if(!out_file.good()) {
-            cerr << "failed to open file wxWidgets.cmake for write" << endl;
-            exit(1);
-        }
-
-        out_file << ss.str() << endl;
-        out_file.close();
-        std::filesystem::path cwd = std::filesystem::current_path() / "wxWidgets.cmake";
-        string path = cwd.string();
-        std::replace(path.begin(), path.end(), '\\', '/');
-        cout << path << endl;
+    if(parser.is_generate_files()) {
+        vector<string> generated;
+        if(parser.is_create_cmake_file()) {
+            // When --cmake is passed, we generate a wxWidgets.cmake file to be included
+            // in the user CMakeLists
+            TraceScope scope("write_cmake");
+            generated.push_back(write_generated_file("wxWidgets.cmake", format_cmake_file(flags, parser.get_libs())));
+        }
+        TraceScope scope("generate_files");
+        auto files = generate_build_files(parser, flags);
+        generated.insert(generated.end(), files.begin(), files.end());
 
-    } else {
-        if(parser.is_cxxflags_set()) {
-            add_include_dir(parser, ss, prefix + DIR_SEP + "lib" + DIR_SEP + config);
-            add_include_dir(parser, ss, prefix + DIR_SEP + "include");
-            add_macros(parser, ss);
+        // the files only change when the install does: build.cfg, the lib dir (libs added / removed) or the prefix
+        vector<string> inputs = { prefix + DIR_SEP + "lib" + DIR_SEP + config + DIR_SEP + "build.cfg",
+            prefix + DIR_SEP + "lib" + DIR_SEP + before_first(config, DIR_SEP_STR), prefix };
+        inputs.insert(inputs.end(), parser.get_objects().begin(), parser.get_objects().end());
+        write_depfile(parser, generated, inputs);
 
-            if(!cxxflags.empty()) {
-                ss << cxxflags << " ";
+    } else {
+        {
+            TraceScope scope("format_output");
+            if(parser.is_json()) {
+                ss << format_json(flags);
+            } else if(parser.is_response_file()) {
+                // a single short argument, stable for a given set of flags
+                vector<string> args = parser.is_cxxflags_set() ? cflags_list(flags)
+                                      : parser.is_rcflags_set() ? rcflags_list(flags)
+                                                                : libs_list(flags);
+                ss << "@" << write_response_file(args, parser.get_response_file_dir());
+            } else if(parser.is_cxxflags_set()) {
+                ss << format_cflags(flags);
+            } else if(parser.is_rcflags_set()) {
+                // print resource compiler flags
+                ss << format_rcflags(flags);
+            } else {
+                // print linker flags
+                ss << format_libs(flags);
             }
-
-        } else if(parser.is_rcflags_set()) {
-            // print resource compiler flags
-            ss << "--include-dir " << prefix << DIR_SEP << "lib" << DIR_SEP << config << " ";
-            ss << "--include-dir " << prefix << DIR_SEP << "include"
-               << " ";
-            ss << "--define __WXMSW__ ";
-            ss << "--define _UNICODE ";
-            ss << "--define WXUSINGDLL ";
-        } else {
-            // print linker flags
-            add_libs(parser, config, prefix, ss);
         }
+
+        TraceScope scope("write_output");
         cout << ss.str() << endl;
+        cache.store(ss.str() + "\n");
     }
     return 0;
 }
+
+int main(int argc, char** argv)
+{
+    if(has_arg(argc, argv, "--server")) {
+        QueryServer server("wx-config");
+        return server.run([](int argc, char** argv) { return run_query(argc, argv, false); },
+            []() {
+                reset_local_state();
+                reset_auto_libs_state();
+                reset_lib_index_state();
+            });
+    }
+
+    TraceSession trace("wx-config", argc, argv);
+
+    // --cmake and friends write into the working directory, --profile looks up the compiler in our PATH: always run
+    // them locally
+    int exit_code = 0;
+    if(!has_generator_arg(argc, argv)) {
+        TraceScope scope("forward_query");
+        if(forward_query("wx-config", argc, argv, exit_code)) {
+            return exit_code;
+        }
+    }
+    return run_query(argc, argv, true);
+}
@@ -0,0 +1,275 @@
+#include "wx_config_api.h"
+
+#include "build_cfg.hpp"
+#include "lib_index.hpp"
+#include "local_install.hpp"
+#include "mapped_file.hpp"
+#include "msys2_install.hpp"
+#include "utils.hpp"
+#include "wx_flags.hpp"
+
+#include <filesystem>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/// everything the context learned about its install, replaced as a whole when the install changes
+struct InstallState {
+    FileStamp stamp; // build.cfg (local) or the lib dir (MSYS2)
+    BuildCfg build_cfg;
+    string wx_ver; // MSYS2 only, e.g. "-3.2"
+};
+
+struct wx_config_context {
+    wx_config_install_kind kind = WX_CONFIG_INSTALL_MSYS2;
+    string prefix;
+    string config;
+    shared_mutex mutex;
+    shared_ptr<const InstallState> state;
+};
+
+struct wx_config_result {
+    string version;
+    vector<string> args[3];
+    string lines[3];
+};
+
+namespace
+{
+thread_local string last_error;
+
+wx_config_status fail(wx_config_status status, const string& message)
+{
+    last_error = message;
+    return status;
+}
+
+/// the file whose stamp tells whether `context` must re-read the install
+string get_watched_path(const wx_config_context& context)
+{
+    if(context.kind == WX_CONFIG_INSTALL_LOCAL) {
+        return get_build_cfg_path(context.prefix, context.config);
+    }
+    return context.prefix + "/lib";
+}
+
+/// read the install of `context` into `state`
+wx_config_status load_state(const wx_config_context& context, InstallState& state)
+{
+    string path = get_watched_path(context);
+    state.stamp = get_file_stamp(path);
+    if(context.kind == WX_CONFIG_INSTALL_LOCAL) {
+        BuildCfg::eLoadResult status = state.build_cfg.load(path);
+        if(status != BuildCfg::kLoadOk) {
+            return fail(WX_CONFIG_ERROR_BAD_BUILD_CFG, build_cfg_error(status, path));
+        }
+        return WX_CONFIG_OK;
+    }
+
+    if(!state.stamp.exists) {
+        return fail(WX_CONFIG_ERROR_NO_INSTALL, "directory: " + path + " does not exist");
+    }
+    // the config of an MSYS2 context is an optional version, like WXVER
+    string version = context.config;
+    if(version.empty() && detect_wx_version(path, version) != kVersionOk) {
+        return fail(WX_CONFIG_ERROR_NO_VERSION, "could not determine the wxWidgets version installed in: " + path);
+    }
+    state.wx_ver = "-" + version;
+    return WX_CONFIG_OK;
+}
+
+/// the state of `context`, re-read first if the install changed since it was loaded
+wx_config_status get_state(wx_config_context& context, shared_ptr<const InstallState>& state)
+{
+    FileStamp stamp = get_file_stamp(get_watched_path(context));
+    {
+        shared_lock lock(context.mutex);
+        if(context.state && context.state->stamp == stamp) {
+            state = context.state;
+            return WX_CONFIG_OK;
+        }
+    }
+
+    auto new_state = make_shared<InstallState>();
+    wx_config_status status = load_state(context, *new_state);
+    if(status != WX_CONFIG_OK) {
+        return status;
+    }
+    unique_lock lock(context.mutex);
+    context.state = new_state;
+    state = new_state;
+    return WX_CONFIG_OK;
+}
+
+string join_args(const vector<string>& args)
+{
+    string line;
+    for(const auto& arg : args) {
+        line += (line.empty() ? "" : " ") + arg;
+    }
+    return line;
+}
+}
+
+extern "C" {
+
+wx_config_status wx_config_context_create(
+    wx_config_install_kind kind, const char* prefix, const char* config, wx_config_context** context)
+{
+    if(context == nullptr || prefix == nullptr || (kind != WX_CONFIG_INSTALL_MSYS2 && kind != WX_CONFIG_INSTALL_LOCAL)) {
+        return fail(WX_CONFIG_ERROR_INVALID_ARGUMENT, "invalid argument");
+    }
+    if(kind == WX_CONFIG_INSTALL_LOCAL && (config == nullptr || *config == 0)) {
+        return fail(WX_CONFIG_ERROR_INVALID_ARGUMENT, "a local install requires a config, e.g. gcc_x64_dll/mswu");
+    }
+    *context = nullptr;
+
+    try {
+        auto new_context = make_unique<wx_config_context>();
+        new_context->kind = kind;
+        // same normalization as the command line tools
+        new_context->prefix = prefix;
+        replace(new_context->prefix.begin(), new_context->prefix.end(), '\\', DIR_SEP);
+        trim(new_context->prefix, true, " \t\\/");
+        new_context->config = config ? config : "";
+        replace(new_context->config.begin(), new_context->config.end(), '\\', DIR_SEP);
+
+        if(!filesystem::is_directory(new_context->prefix)) {
+            return fail(WX_CONFIG_ERROR_NO_INSTALL, "directory: " + new_context->prefix + " does not exist");
+        }
+        shared_ptr<const InstallState> state;
+        wx_config_status status = get_state(*new_context, state);
+        if(status != WX_CONFIG_OK) {
+            return status;
+        }
+        *context = new_context.release();
+        return WX_CONFIG_OK;
+    } catch(const exception& e) {
+        return fail(WX_CONFIG_ERROR_INTERNAL, e.what());
+    } catch(...) {
+        return fail(WX_CONFIG_ERROR_INTERNAL, "unexpected error");
+    }
+}
+
+void wx_config_context_destroy(wx_config_context* context) { delete context; }
+
+wx_config_status wx_config_query(
+    wx_config_context* context, const wx_config_query_options* options, wx_config_result** result)
+{
+    if(context == nullptr || result == nullptr) {
+        return fail(WX_CONFIG_ERROR_INVALID_ARGUMENT, "invalid argument");
+    }
+    *result = nullptr;
+    wx_config_query_options defaults = {};
+    if(options == nullptr) {
+        options = &defaults;
+    }
+
+    try {
+        shared_ptr<const InstallState> state;
+        wx_config_status status = get_state(*context, state);
+        if(status != WX_CONFIG_OK) {
+            return status;
+        }
+
+        vector<string> names;
+        if(options->libs) {
+            string token;
+            istringstream iss(options->libs);
+            while(getline(iss, token, ',')) {
+                trim(token);
+                if(!token.empty()) {
+                    names.push_back(token);
+                }
+            }
+        }
+        vector<string> libs = expand_libs(names);
+
+        WxFlags flags = context->kind == WX_CONFIG_INSTALL_LOCAL
+                            ? resolve_local_flags(state->build_cfg, libs, context->prefix, context->config)
+                            : resolve_msys2_flags(libs, context->prefix, state->wx_ver);
+        if(options->absolute) {
+            vector<string> missing =
+                find_lib_files(flags, options->prefer_static ? LibPolicy::kPreferStatic : LibPolicy::kPreferImport);
+            if(!missing.empty()) {
+                return fail(WX_CONFIG_ERROR_MISSING_LIBS, "could not find the following libraries: " + join_args(missing));
+            }
+        }
+        if(options->canonical) {
+            canonicalize_flags(flags);
+        }
+
+        auto new_result = make_unique<wx_config_result>();
+        new_result->version = flags.version;
+        new_result->args[WX_CONFIG_CFLAGS] = cflags_list(flags);
+        new_result->args[WX_CONFIG_LIBS] = libs_list(flags);
+        new_result->args[WX_CONFIG_RCFLAGS] = rcflags_list(flags);
+        for(size_t i = 0; i < 3; ++i) {
+            new_result->lines[i] = join_args(new_result->args[i]);
+        }
+        *result = new_result.release();
+        return WX_CONFIG_OK;
+    } catch(const exception& e) {
+        return fail(WX_CONFIG_ERROR_INTERNAL, e.what());
+    } catch(...) {
+        return fail(WX_CONFIG_ERROR_INTERNAL, "unexpected error");
+    }
+}
+
+void wx_config_result_destroy(wx_config_result* result) { delete result; }
+
+size_t wx_config_result_count(const wx_config_result* result, wx_config_output output)
+{
+    if(result == nullptr || output < WX_CONFIG_CFLAGS || output > WX_CONFIG_RCFLAGS) {
+        return 0;
+    }
+    return result->args[output].size();
+}
+
+const char* wx_config_result_arg(const wx_config_result* result, wx_config_output output, size_t index)
+{
+    if(index >= wx_config_result_count(result, output)) {
+        return nullptr;
+    }
+    return result->args[output][index].c_str();
+}
+
+const char* wx_config_result_line(const wx_config_result* result, wx_config_output output)
+{
+    if(result == nullptr || output < WX_CONFIG_CFLAGS || output > WX_CONFIG_RCFLAGS) {
+        return nullptr;
+    }
+    return result->lines[output].c_str();
+}
+
+const char* wx_config_result_version(const wx_config_result* result)
+{
+    return result == nullptr ? nullptr : result->version.c_str();
+}
+
+const char* wx_config_last_error(void) { return last_error.c_str(); }
+
+const char* wx_config_status_string(wx_config_status status)
+{
+    switch(status) {
+    case WX_CONFIG_OK:
+        return "ok";
+    case WX_CONFIG_ERROR_INVALID_ARGUMENT:
+        return "invalid argument";
+    case WX_CONFIG_ERROR_NO_INSTALL:
+        return "install not found";
+    case WX_CONFIG_ERROR_NO_VERSION:
+        return "wxWidgets version not found";
+    case WX_CONFIG_ERROR_BAD_BUILD_CFG:
+        return "bad build.cfg";
+    case WX_CONFIG_ERROR_MISSING_LIBS:
+        return "missing libraries";
+    case WX_CONFIG_ERROR_INTERNAL:
+        return "internal error";
+    }
+    return "unknown status";
+}
+}
@@ -0,0 +1,92 @@
+#ifndef WX_CONFIG_API_H
+#define WX_CONFIG_API_H
+
+/*
+ * In-process wx-config queries, for hosts (IDEs, build tools) that would otherwise spawn wx-config / wx-config-msys2.
+ *
+ * A context describes one install (an MSYS2 prefix, or a locally built wxWidgets + config). It keeps what it learned
+ * about the install (detected version, parsed build.cfg) and reloads it by itself when the install changes, so hosts
+ * should create a context once and keep it. All the functions are reentrant; a context can be queried from several
+ * threads at once. The error message of the last failed call is kept per thread.
+ */
+
+#include <stddef.h>
+
+#if defined(_WIN32) && defined(WX_CONFIG_API_SHARED)
+#ifdef WX_CONFIG_API_BUILDING
+#define WX_CONFIG_API __declspec(dllexport)
+#else
+#define WX_CONFIG_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__)
+#define WX_CONFIG_API __attribute__((visibility("default")))
+#else
+#define WX_CONFIG_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum wx_config_status {
+    WX_CONFIG_OK = 0,
+    WX_CONFIG_ERROR_INVALID_ARGUMENT = 1, /* NULL pointer, unknown install kind or output */
+    WX_CONFIG_ERROR_NO_INSTALL = 2,       /* the prefix (or its lib dir) does not exist */
+    WX_CONFIG_ERROR_NO_VERSION = 3,       /* no wxWidgets library found in an MSYS2 prefix */
+    WX_CONFIG_ERROR_BAD_BUILD_CFG = 4,    /* build.cfg is missing or lacks required keys */
+    WX_CONFIG_ERROR_MISSING_LIBS = 5,     /* absolute paths requested but some libraries are not installed */
+    WX_CONFIG_ERROR_INTERNAL = 6,
+} wx_config_status;
+
+typedef enum wx_config_install_kind {
+    WX_CONFIG_INSTALL_MSYS2 = 0, /* wx-config-msys2: pacman installed wxWidgets */
+    WX_CONFIG_INSTALL_LOCAL = 1, /* wx-config: locally built wxWidgets */
+} wx_config_install_kind;
+
+typedef enum wx_config_output {
+    WX_CONFIG_CFLAGS = 0,
+    WX_CONFIG_LIBS = 1,
+    WX_CONFIG_RCFLAGS = 2,
+} wx_config_output;
+
+typedef struct wx_config_query_options {
+    const char* libs; /* "std", "all" or a comma separated list ("std,aui"). NULL means "std" */
+    int canonical;    /* non zero: normalized paths and flag order, as --canonical */
+    int absolute;     /* non zero: link the full path of each library, as --absolute */
+    int prefer_static; /* with absolute: prefer lib<name>.a over lib<name>.dll.a */
+} wx_config_query_options;
+
+typedef struct wx_config_context wx_config_context;
+typedef struct wx_config_result wx_config_result;
+
+/**
+ * Create a context for the install under `prefix`. `config` is the build config of a local install (e.g.
+ * "gcc_x64_dll/mswu"); for an MSYS2 install it is an optional version overriding the detection (e.g. "3.2", NULL to
+ * detect). The install is read right away, so errors are reported here
+ */
+WX_CONFIG_API wx_config_status wx_config_context_create(
+    wx_config_install_kind kind, const char* prefix, const char* config, wx_config_context** context);
+WX_CONFIG_API void wx_config_context_destroy(wx_config_context* context);
+
+/** Resolve the flags for `options` (NULL for the defaults). Free the result with wx_config_result_destroy() */
+WX_CONFIG_API wx_config_status wx_config_query(
+    wx_config_context* context, const wx_config_query_options* options, wx_config_result** result);
+WX_CONFIG_API void wx_config_result_destroy(wx_config_result* result);
+
+/** The number of arguments of `output`, and each of them. The strings live as long as the result */
+WX_CONFIG_API size_t wx_config_result_count(const wx_config_result* result, wx_config_output output);
+WX_CONFIG_API const char* wx_config_result_arg(const wx_config_result* result, wx_config_output output, size_t index);
+/** `output` as a single command line fragment, as printed by the tools */
+WX_CONFIG_API const char* wx_config_result_line(const wx_config_result* result, wx_config_output output);
+/** The detected wxWidgets version, e.g. "3.2" */
+WX_CONFIG_API const char* wx_config_result_version(const wx_config_result* result);
+
+/** The message of the last call that failed on this thread, empty if none */
+WX_CONFIG_API const char* wx_config_last_error(void);
+WX_CONFIG_API const char* wx_config_status_string(wx_config_status status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WX_CONFIG_API_H */
@@ -0,0 +1,579 @@
+#include "wx_flags.hpp"
+
+#include "cache.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace
+{
+void write_json_array(stringstream& ss, const vector<string>& items)
+{
+    ss << "[";
+    for(size_t i = 0; i < items.size(); ++i) {
+        ss << (i == 0 ? "" : ", ") << "\"" << json_escape(items[i]) << "\"";
+    }
+    ss << "]";
+}
+
+string trimmed(string str)
+{
+    trim(str);
+    return str;
+}
+
+string join(const vector<string>& items, const string& sep = " ")
+{
+    string result;
+    for(const auto& item : items) {
+        if(!result.empty()) {
+            result += sep;
+        }
+        result += item;
+    }
+    return result;
+}
+
+/// escape `$` and `#` for a make variable assignment
+string make_escape(const string& str)
+{
+    string result;
+    for(char ch : str) {
+        if(ch == '$') {
+            result += "$$";
+        } else if(ch == '#') {
+            result += "\\#";
+        } else {
+            result += ch;
+        }
+    }
+    return result;
+}
+
+/// a Meson array literal
+string meson_array(const vector<string>& items)
+{
+    string result = "[";
+    for(size_t i = 0; i < items.size(); ++i) {
+        string item;
+        for(char ch : items[i]) {
+            if(ch == '\'' || ch == '\\') {
+                item += '\\';
+            }
+            item += ch;
+        }
+        result += (i == 0 ? "'" : ", '") + item + "'";
+    }
+    return result + "]";
+}
+
+/// remove the duplicates of `items`, keeping the first occurrence
+void remove_duplicates(vector<string>& items)
+{
+    vector<string> result;
+    for(const auto& item : items) {
+        if(find(result.begin(), result.end(), item) == result.end()) {
+            result.push_back(item);
+        }
+    }
+    items.swap(result);
+}
+
+/// quote `arg` for a GCC style response file, if needed
+string response_file_quote(const string& arg)
+{
+    if(!arg.empty() && arg.find_first_of(" \t\r\n\"'\\") == string::npos) {
+        return arg;
+    }
+    string result = "\"";
+    for(char ch : arg) {
+        if(ch == '"' || ch == '\\') {
+            result += '\\';
+        }
+        result += ch;
+    }
+    return result + "\"";
+}
+
+constexpr const char* kGeneratedBanner = "Auto Generated by wx-config: https://github.com/eranif/wx-config-msys2";
+}
+
+string normalize_path(const string& path)
+{
+    if(path.empty()) {
+        return path;
+    }
+    string result = path;
+    replace(result.begin(), result.end(), '\\', '/');
+    result = filesystem::path(result).lexically_normal().generic_string();
+
+    // c:/msys64 and C:/msys64 are the same directory
+    bool has_drive = result.length() >= 2 && result[1] == ':' && isalpha(static_cast<unsigned char>(result[0]));
+    if(has_drive) {
+        result[0] = static_cast<char>(toupper(static_cast<unsigned char>(result[0])));
+    }
+    // keep the root ("/" or "C:/")
+    size_t root_length = has_drive ? 3 : 1;
+    while(result.length() > root_length && result.back() == '/') {
+        result.pop_back();
+    }
+    return result;
+}
+
+string get_prefix_alias(const string& prefix, const string& requested)
+{
+    if(!requested.empty()) {
+        return requested;
+    }
+    string normalized_prefix = normalize_path(prefix);
+    istringstream iss(safe_getenv("WXCONFIG_PREFIX_MAP"));
+    string entry;
+    while(getline(iss, entry, ';')) {
+        // the prefix may hold a drive letter, but no `=`
+        size_t sep = entry.find('=');
+        if(sep != string::npos && normalize_path(entry.substr(0, sep)) == normalized_prefix) {
+            return entry.substr(sep + 1);
+        }
+    }
+    return "/wx";
+}
+
+void remap_prefix(WxFlags& flags, const string& alias)
+{
+    string prefix = normalize_path(flags.prefix);
+    flags.include_prefix = prefix;
+    flags.compile_flags.push_back("-ffile-prefix-map=" + prefix + "=" + alias);
+    // older compilers only know this one, newer ones accept both
+    flags.compile_flags.push_back("-fdebug-prefix-map=" + prefix + "=" + alias);
+}
+
+void canonicalize_flags(WxFlags& flags)
+{
+    flags.prefix = normalize_path(flags.prefix);
+    for(auto& dir : flags.include_dirs) {
+        dir = normalize_path(dir);
+    }
+    for(auto& dir : flags.lib_dirs) {
+        dir = normalize_path(dir);
+    }
+    for(auto& file : flags.lib_files) {
+        file = normalize_path(file);
+    }
+    // the search order of the dirs and of the libs matters, only drop the repeated entries
+    remove_duplicates(flags.include_dirs);
+    remove_duplicates(flags.lib_dirs);
+    remove_duplicates(flags.libs);
+    remove_duplicates(flags.lib_files);
+    remove_duplicates(flags.link_flags);
+
+    // the options keep their order, the macros follow them sorted
+    vector<string> options, defines;
+    for(const auto& flag : flags.compile_flags) {
+        (flag.starts_with("-D") ? defines : options).push_back(flag);
+    }
+    remove_duplicates(options);
+    sort(defines.begin(), defines.end());
+    defines.erase(unique(defines.begin(), defines.end()), defines.end());
+    flags.compile_flags = options;
+    flags.compile_flags.insert(flags.compile_flags.end(), defines.begin(), defines.end());
+
+    sort(flags.rc_defines.begin(), flags.rc_defines.end());
+    flags.rc_defines.erase(unique(flags.rc_defines.begin(), flags.rc_defines.end()), flags.rc_defines.end());
+
+    // paths can also hide in the CXXFLAGS of build.cfg
+    vector<string> extra = split_args(flags.extra_cxxflags);
+    for(size_t i = 0; i < extra.size(); ++i) {
+        for(const char* option : { "-I", "-isystem" }) {
+            if(extra[i] == option && i + 1 < extra.size()) {
+                extra[i + 1] = normalize_path(extra[i + 1]);
+                ++i;
+                break;
+            } else if(extra[i].starts_with(option) && extra[i].length() > strlen(option)) {
+                extra[i] = option + normalize_path(extra[i].substr(strlen(option)));
+                break;
+            }
+        }
+    }
+    flags.extra_cxxflags = join(extra);
+}
+
+string write_response_file(const vector<string>& args, const string& dir)
+{
+    string content;
+    for(const auto& arg : args) {
+        content += response_file_quote(arg);
+        content += "\n";
+    }
+
+    string rsp_dir = dir;
+    if(rsp_dir.empty()) {
+        rsp_dir = get_cache_dir();
+        if(rsp_dir.empty()) {
+            cerr << "could not determine the cache directory, please set XDG_CACHE_HOME or pass --response-file=<dir>"
+                 << endl;
+            fatal_exit(1);
+        }
+        rsp_dir += DIR_SEP_STR "rsp";
+    }
+    string path = normalize_path(rsp_dir) + DIR_SEP + "wx-" + to_hex(fnv1a_64(content)) + ".rsp";
+
+    // the name is the hash of the content: an existing file is already right
+    if(filesystem::exists(path)) {
+        return path;
+    }
+
+    error_code ec;
+    filesystem::create_directories(rsp_dir, ec);
+    if(!write_file_if_changed(path, content)) {
+        cerr << "failed to write " << path << endl;
+        fatal_exit(1);
+    }
+    return path;
+}
+
+namespace
+{
+/// the -I options, or -iprefix / -iwithprefixbefore for the dirs under the include prefix
+vector<string> include_args(const WxFlags& flags)
+{
+    vector<string> result;
+    if(!flags.include_prefix.empty()) {
+        // GCC and clang paste the two arguments together
+        result.push_back("-iprefix");
+        result.push_back(flags.include_prefix + "/");
+    }
+    for(const auto& dir : flags.include_dirs) {
+        string normalized_dir = normalize_path(dir);
+        if(!flags.include_prefix.empty() && normalized_dir.starts_with(flags.include_prefix + "/")) {
+            result.push_back("-iwithprefixbefore");
+            result.push_back(normalized_dir.substr(flags.include_prefix.length() + 1));
+        } else {
+            result.push_back("-I" + dir);
+        }
+    }
+    return result;
+}
+}
+
+string format_cflags(const WxFlags& flags)
+{
+    stringstream ss;
+    for(const auto& arg : include_args(flags)) {
+        ss << arg << " ";
+    }
+    for(const auto& flag : flags.compile_flags) {
+        ss << flag << " ";
+    }
+    if(!flags.extra_cxxflags.empty()) {
+        ss << flags.extra_cxxflags << " ";
+    }
+    for(const auto& flag : flags.profile_flags) {
+        ss << flag << " ";
+    }
+    return ss.str();
+}
+
+string format_rcflags(const WxFlags& flags)
+{
+    stringstream ss;
+    for(const auto& dir : flags.include_dirs) {
+        ss << "--include-dir " << dir << " ";
+    }
+    for(const auto& def : flags.rc_defines) {
+        ss << "--define " << def << " ";
+    }
+    return ss.str();
+}
+
+string format_libs(const WxFlags& flags)
+{
+    stringstream ss;
+    for(const auto& arg : libs_list(flags)) {
+        ss << arg << " ";
+    }
+    return ss.str();
+}
+
+vector<string> split_args(const string& str)
+{
+    vector<string> result;
+    istringstream iss(str);
+    string token;
+    while(iss >> token) {
+        result.push_back(token);
+    }
+    return result;
+}
+
+vector<string> cflags_list(const WxFlags& flags)
+{
+    vector<string> result = include_args(flags);
+    result.insert(result.end(), flags.compile_flags.begin(), flags.compile_flags.end());
+    auto extra = split_args(flags.extra_cxxflags);
+    result.insert(result.end(), extra.begin(), extra.end());
+    result.insert(result.end(), flags.profile_flags.begin(), flags.profile_flags.end());
+    return result;
+}
+
+vector<string> libs_list(const WxFlags& flags)
+{
+    // with --absolute the linker does not have to search anything
+    if(!flags.lib_files.empty()) {
+        vector<string> result = flags.link_flags;
+        result.insert(result.end(), flags.lib_files.begin(), flags.lib_files.end());
+        return result;
+    }
+
+    vector<string> result;
+    for(const auto& dir : flags.lib_dirs) {
+        result.push_back("-L" + dir);
+    }
+    result.insert(result.end(), flags.link_flags.begin(), flags.link_flags.end());
+    for(const auto& lib : flags.libs) {
+        result.push_back("-l" + lib);
+    }
+    return result;
+}
+
+vector<string> rcflags_list(const WxFlags& flags)
+{
+    vector<string> result;
+    for(const auto& dir : flags.include_dirs) {
+        result.push_back("--include-dir");
+        result.push_back(dir);
+    }
+    for(const auto& def : flags.rc_defines) {
+        result.push_back("--define");
+        result.push_back(def);
+    }
+    return result;
+}
+
+string format_pkg_config(const WxFlags& flags)
+{
+    stringstream ss;
+    ss << "# " << kGeneratedBanner << "\n";
+    ss << "# Usage: PKG_CONFIG_PATH=<this dir> pkg-config --cflags --libs wx\n";
+    ss << "#        PKG_CONFIG_PATH=<this dir> pkg-config --variable=rcflags wx\n\n";
+    ss << "prefix=" << flags.prefix << "\n";
+    ss << "rcflags=" << trimmed(format_rcflags(flags)) << "\n\n";
+    ss << "Name: wxWidgets\n";
+    ss << "Description: wxWidgets " << flags.version << " (" << flags.tool << ")\n";
+    ss << "Version: " << flags.version << "\n";
+    ss << "Cflags: " << trimmed(format_cflags(flags)) << "\n";
+    ss << "Libs: " << trimmed(format_libs(flags)) << "\n";
+    return ss.str();
+}
+
+string format_make(const WxFlags& flags)
+{
+    stringstream ss;
+    ss << "## " << kGeneratedBanner << "\n";
+    ss << "## Include this file in your Makefile:\n";
+    ss << "## include wx.mk\n\n";
+    ss << "WX_VERSION := " << flags.version << "\n";
+    ss << "WX_CXXFLAGS := " << make_escape(join(cflags_list(flags))) << "\n";
+    ss << "WX_LIBS := " << make_escape(join(libs_list(flags))) << "\n";
+    ss << "WX_RCFLAGS := " << make_escape(join(rcflags_list(flags))) << "\n";
+    return ss.str();
+}
+
+string format_meson(const WxFlags& flags)
+{
+    stringstream ss;
+    ss << "## " << kGeneratedBanner << "\n";
+    ss << "## Pass this file to meson: meson setup --native-file wx-meson.ini builddir\n";
+    ss << "## and declare the dependency in meson.build:\n";
+    ss << "## wx_dep = declare_dependency(compile_args : meson.get_external_property('wx_cxxflags'),\n";
+    ss << "##                             link_args : meson.get_external_property('wx_libs'))\n\n";
+    ss << "[properties]\n";
+    ss << "wx_version = '" << flags.version << "'\n";
+    ss << "wx_cxxflags = " << meson_array(cflags_list(flags)) << "\n";
+    ss << "wx_libs = " << meson_array(libs_list(flags)) << "\n";
+    ss << "wx_rcflags = " << meson_array(rcflags_list(flags)) << "\n";
+    return ss.str();
+}
+
+string write_generated_file(const string& filename, const string& content)
+{
+    // parallel jobs may generate the same file: never truncate it in place, and leave it alone when it is up to date
+    // so the build system does not re-run its configure step
+    if(!write_file_if_changed(filename, content)) {
+        cerr << "failed to open file " << filename << " for write" << endl;
+        fatal_exit(1);
+    }
+
+    std::filesystem::path cwd = std::filesystem::current_path() / filename;
+    string path = cwd.string();
+    std::replace(path.begin(), path.end(), '\\', '/');
+    cout << path << endl;
+    return path;
+}
+
+vector<string> generate_build_files(const CommandLineParser& parser, const WxFlags& flags)
+{
+    vector<string> paths;
+    if(parser.is_create_pkg_config_file()) {
+        paths.push_back(write_generated_file("wx.pc", format_pkg_config(flags)));
+    }
+    if(parser.is_create_make_file()) {
+        paths.push_back(write_generated_file("wx.mk", format_make(flags)));
+    }
+    if(parser.is_create_meson_file()) {
+        paths.push_back(write_generated_file("wx-meson.ini", format_meson(flags)));
+    }
+    return paths;
+}
+
+string format_depfile(const vector<string>& targets, const vector<string>& inputs)
+{
+    auto escape = [](const string& path) {
+        string result;
+        for(char ch : normalize_path(path)) {
+            if(ch == ' ' || ch == '#') {
+                result += '\\';
+            } else if(ch == '$') {
+                result += '$';
+            }
+            result += ch;
+        }
+        return result;
+    };
+
+    string result;
+    for(const auto& target : targets) {
+        result += (result.empty() ? "" : " ") + escape(target);
+    }
+    result += ":";
+    for(const auto& input : inputs) {
+        result += " \\\n  " + escape(input);
+    }
+    return result + "\n";
+}
+
+void write_depfile(const CommandLineParser& parser, const vector<string>& targets, const vector<string>& inputs)
+{
+    if(parser.get_depfile().empty()) {
+        return;
+    }
+    if(!write_file_if_changed(parser.get_depfile(), format_depfile(targets, inputs))) {
+        cerr << "failed to write " << parser.get_depfile() << endl;
+        fatal_exit(1);
+    }
+}
+
+string format_json(const WxFlags& flags)
+{
+    vector<string> defines, options;
+    for(const auto& flag : flags.compile_flags) {
+        if(flag.starts_with("-D")) {
+            defines.push_back(flag.substr(2));
+        } else {
+            options.push_back(flag);
+        }
+    }
+
+    stringstream ss;
+    ss << "{\n";
+    ss << "  \"tool\": \"" << json_escape(flags.tool) << "\",\n";
+    ss << "  \"prefix\": \"" << json_escape(flags.prefix) << "\",\n";
+    ss << "  \"config\": \"" << json_escape(flags.config) << "\",\n";
+    ss << "  \"version\": \"" << json_escape(flags.version) << "\",\n";
+    ss << "  \"compiler\": \"" << json_escape(flags.compiler) << "\",\n";
+    ss << "  \"build\": \"" << json_escape(flags.build) << "\",\n";
+    ss << "  \"monolithic\": " << (flags.monolithic ? "true" : "false") << ",\n";
+    ss << "  \"debug\": " << (flags.debug ? "true" : "false") << ",\n";
+    ss << "  \"include_dirs\": ";
+    write_json_array(ss, flags.include_dirs);
+    ss << ",\n  \"defines\": ";
+    write_json_array(ss, defines);
+    ss << ",\n  \"compile_options\": ";
+    write_json_array(ss, options);
+    ss << ",\n  \"extra_cxxflags\": \"" << json_escape(flags.extra_cxxflags) << "\",\n";
+    if(!flags.profile_flags.empty()) {
+        ss << "  \"profile_options\": ";
+        write_json_array(ss, flags.profile_flags);
+        ss << ",\n";
+    }
+    ss << "  \"rc_defines\": ";
+    write_json_array(ss, flags.rc_defines);
+    ss << ",\n  \"lib_dirs\": ";
+    write_json_array(ss, flags.lib_dirs);
+    ss << ",\n  \"link_options\": ";
+    write_json_array(ss, flags.link_flags);
+    ss << ",\n  \"libraries\": ";
+    write_json_array(ss, flags.libs);
+    if(!flags.lib_files.empty()) {
+        ss << ",\n  \"library_files\": ";
+        write_json_array(ss, flags.lib_files);
+    }
+    ss << ",\n  \"cflags\": \"" << json_escape(trimmed(format_cflags(flags))) << "\",\n";
+    ss << "  \"rcflags\": \"" << json_escape(trimmed(format_rcflags(flags))) << "\",\n";
+    ss << "  \"libs\": \"" << json_escape(trimmed(format_libs(flags))) << "\"\n";
+    ss << "}";
+    return ss.str();
+}
+
+string format_manifest(const string& tool, const string& prefix, const vector<WxFlags>& configs)
+{
+    stringstream ss;
+    ss << "{\n";
+    ss << "  \"tool\": \"" << json_escape(tool) << "\",\n";
+    ss << "  \"prefix\": \"" << json_escape(prefix) << "\",\n";
+    ss << "  \"configs\": [";
+    for(size_t i = 0; i < configs.size(); ++i) {
+        // nest the --json document, two levels deeper
+        string json = format_json(configs[i]);
+        ss << (i == 0 ? "\n    " : ",\n    ");
+        for(char ch : json) {
+            ss << ch;
+            if(ch == '\n') {
+                ss << "    ";
+            }
+        }
+    }
+    ss << (configs.empty() ? "]\n" : "\n  ]\n");
+    ss << "}";
+    return ss.str();
+}
+
+string json_escape(const string& str)
+{
+    string result;
+    result.reserve(str.length());
+    for(char ch : str) {
+        switch(ch) {
+        case '"':
+            result += "\\\"";
+            break;
+        case '\\':
+            result += "\\\\";
+            break;
+        case '\n':
+            result += "\\n";
+            break;
+        case '\r':
+            result += "\\r";
+            break;
+        case '\t':
+            result += "\\t";
+            break;
+        default:
+            if(static_cast<unsigned char>(ch) < 0x20) {
+                static const char digits[] = "0123456789abcdef";
+                result += "\\u00";
+                result += digits[(ch >> 4) & 0xf];
+                result += digits[ch & 0xf];
+            } else {
+                result += ch;
+            }
+            break;
+        }
+    }
+    return result;
+}
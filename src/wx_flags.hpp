@@ -0,0 +1,117 @@
+#ifndef WX_FLAGS_HPP
+#define WX_FLAGS_HPP
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief everything wx-config / wx-config-msys2 resolved for a given prefix (and config)
+ *
+ * Both tools fill this structure once and all the output forms (--cflags, --rcflags, --libs, --json) are formatted
+ * from it
+ */
+struct WxFlags {
+    string tool;
+    string prefix;
+    string config;       // wx-config only, e.g. clang_x64_dll/mswu
+    string version;      // e.g. 3.2
+    string compiler;     // from build.cfg (wx-config only)
+    string build;        // "release" or "debug"
+    bool monolithic = false;
+    bool debug = false;
+    bool shared = false; // the wx libs are DLLs
+
+    vector<string> include_dirs;
+    string include_prefix;        // --remap-prefix: the include dirs under it are passed relative to it
+    vector<string> compile_flags; // -D and other compiler options, in command line order
+    string extra_cxxflags;        // CXXFLAGS from build.cfg
+    vector<string> profile_flags; // --profile compile options, last so they override the CXXFLAGS of build.cfg
+    vector<string> rc_defines;
+
+    vector<string> lib_dirs;
+    vector<string> link_flags;
+    vector<string> libs; // library names, without the -l
+    vector<string> lib_files; // --absolute: the full path of each lib, linked instead of the -L dirs and -l libs
+};
+
+/// the --cflags output
+string format_cflags(const WxFlags& flags);
+/// the --rcflags output
+string format_rcflags(const WxFlags& flags);
+/// the --libs output
+string format_libs(const WxFlags& flags);
+/// the --json output: every field above + the three formatted lines
+string format_json(const WxFlags& flags);
+/**
+ * @brief the --manifest output: the --json document of every config in `configs`, in a single JSON document
+ */
+string format_manifest(const string& tool, const string& prefix, const vector<WxFlags>& configs);
+
+/// split on white spaces (used for the free-form CXXFLAGS from build.cfg)
+vector<string> split_args(const string& str);
+
+/// the --cflags / --libs / --rcflags output as separate arguments
+vector<string> cflags_list(const WxFlags& flags);
+vector<string> libs_list(const WxFlags& flags);
+vector<string> rcflags_list(const WxFlags& flags);
+
+/// content of a pkg-config file (wx.pc). The resource compiler flags are exposed as the `rcflags` variable
+string format_pkg_config(const WxFlags& flags);
+/// content of a GNU make fragment (wx.mk) defining WX_CXXFLAGS, WX_LIBS and WX_RCFLAGS
+string format_make(const WxFlags& flags);
+/// content of a Meson native file (wx-meson.ini) defining the wx_* properties
+string format_meson(const WxFlags& flags);
+
+/**
+ * @brief write `content` into `filename` in the current directory (see write_file_if_changed()), print its full path
+ * and return it
+ */
+string write_generated_file(const string& filename, const string& content);
+
+class CommandLineParser;
+/**
+ * @brief write every build file requested on the command line (--pkg-config, --make, --meson). Return their paths
+ */
+vector<string> generate_build_files(const CommandLineParser& parser, const WxFlags& flags);
+
+/// a Make / Ninja depfile rule: `targets` depend on `inputs`
+string format_depfile(const vector<string>& targets, const vector<string>& inputs);
+
+/// --depfile=<path>: record that the generated `targets` depend on `inputs`. Does nothing without --depfile
+void write_depfile(const CommandLineParser& parser, const vector<string>& targets, const vector<string>& inputs);
+
+/// `path` with forward slashes, without "." / ".." / repeated / trailing separators and with an upper case drive letter
+string normalize_path(const string& path);
+
+/**
+ * @brief --canonical: normalize every path (see normalize_path()), drop repeated dirs, libs and options and sort the
+ * macros, so equivalent installs and prefixes (`C:\msys64` vs `c:/msys64/`) produce byte-identical flags
+ */
+void canonicalize_flags(WxFlags& flags);
+
+/**
+ * @brief the alias --remap-prefix maps `prefix` to: `requested` when given, else the entry of `prefix` in
+ * WXCONFIG_PREFIX_MAP (`<prefix>=<alias>` entries separated by `;`), else /wx
+ */
+string get_prefix_alias(const string& prefix, const string& requested);
+
+/**
+ * @brief --remap-prefix: make the compile flags of the same install identical wherever it lives. The include dirs under
+ * the prefix are passed relative to it (`-iprefix <prefix>/ -iwithprefixbefore <dir>`), so the prefix appears in a
+ * single argument, and `-ffile-prefix-map` / `-fdebug-prefix-map` rewrite it to `alias` in the objects (__FILE__, debug
+ * info)
+ */
+void remap_prefix(WxFlags& flags, const string& alias);
+
+/**
+ * @brief write `args`, one per line, into `<dir>/wx-<hash of the content>.rsp` (unless it already exists) and return
+ * its path. `dir` defaults to <cache dir>/rsp
+ */
+string write_response_file(const vector<string>& args, const string& dir);
+
+/// escape `str` for use as a JSON string literal (without the quotes)
+string json_escape(const string& str);
+
+#endif // WX_FLAGS_HPP
@@ -0,0 +1,58 @@
+#ifndef WX_VERSION_HPP
+#define WX_VERSION_HPP
+
+#include <cstddef>
+#include <string_view>
+
+using namespace std;
+
+/**
+ * @brief find the first `libwx_baseu-<major>.<minor>` in `path` (same result as the regex
+ * `libwx_baseu\-([\d]+)[\.]{1}([\d]+)`). On match, `major` and `minor` point into `path`. Never allocates
+ */
+constexpr bool match_wx_base_version(string_view path, string_view& major, string_view& minor)
+{
+    constexpr string_view needle = "libwx_baseu-";
+    auto is_digit = [](char ch) { return ch >= '0' && ch <= '9'; };
+
+    // the regex is unanchored: a candidate that is not followed by <digits>.<digits> does not stop the search
+    for(size_t where = path.find(needle); where != string_view::npos; where = path.find(needle, where + 1)) {
+        size_t pos = where + needle.length();
+        size_t major_start = pos;
+        while(pos < path.length() && is_digit(path[pos])) {
+            ++pos;
+        }
+        if(pos == major_start || pos == path.length() || path[pos] != '.') {
+            continue;
+        }
+        size_t major_end = pos++;
+        size_t minor_start = pos;
+        while(pos < path.length() && is_digit(path[pos])) {
+            ++pos;
+        }
+        if(pos == minor_start) {
+            continue;
+        }
+        // in range by construction, no need for the checks of substr()
+        major = string_view(path.data() + major_start, major_end - major_start);
+        minor = string_view(path.data() + minor_start, pos - minor_start);
+        return true;
+    }
+    return false;
+}
+
+/// the weight used to pick the newest installed version: major * 100 + minor * 10
+constexpr size_t wx_version_weight(string_view major, string_view minor)
+{
+    // equivalent to atoi() on each component
+    auto to_number = [](string_view digits) {
+        size_t value = 0;
+        for(char ch : digits) {
+            value = value * 10 + (ch - '0');
+        }
+        return value;
+    };
+    return (to_number(major) * 100) + (to_number(minor) * 10);
+}
+
+#endif // WX_VERSION_HPP